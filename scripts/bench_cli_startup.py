@@ -0,0 +1,101 @@
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+from pathlib import Path
+from typing import Dict, List
+
+from codeforesight.config import PROJECT_ROOT
+
+MODES: Dict[str, List[str]] = {
+    "full": [],
+    "llm-only": ["--llm-only"],
+    "stage1": ["--stage1"],
+    "stage2": ["--stage2"],
+    "stage3": ["--stage3"],
+}
+HEAVY_MODULES = ["sklearn", "scipy", "joblib", "numpy", "zstandard", "llama_cpp"]
+
+# Runs the CLI in-process and reports which heavy modules it pulled in.
+_RUNNER = """
+import atexit, json, runpy, sys
+heavy = json.loads(sys.argv.pop(1))
+atexit.register(lambda: print(json.dumps([m for m in heavy if m in sys.modules]), file=sys.stderr))
+sys.argv[0] = "codeforesight.cli"
+runpy.run_module("codeforesight.cli", run_name="__main__")
+"""
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Cold-start time to first output byte per CLI mode")
+    parser.add_argument("--input", default=str(PROJECT_ROOT / "demo_vuln.c"), help="Source file to scan")
+    parser.add_argument("--runs", type=int, default=5, help="Cold starts per mode")
+    parser.add_argument("--modes", nargs="+", choices=sorted(MODES), default=list(MODES))
+    parser.add_argument(
+        "--budget-ms",
+        type=float,
+        default=None,
+        help="Exit non-zero if a mode's median time to first byte exceeds this",
+    )
+    parser.add_argument("--out", help="Optional path to write JSON results")
+    return parser.parse_args()
+
+
+def _cold_start(flags: List[str], input_path: str, env: Dict[str, str]) -> tuple[float, float, List[str]]:
+    """(ms to first stdout byte, ms to exit, heavy modules imported) for one fresh interpreter."""
+    command = [sys.executable, "-c", _RUNNER, json.dumps(HEAVY_MODULES), "--input", input_path, *flags]
+    start = time.perf_counter()
+    proc = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    first = proc.stdout.read(1)
+    first_byte_ms = (time.perf_counter() - start) * 1000
+    proc.stdout.read()
+    stderr = proc.stderr.read().decode("utf-8", errors="ignore")
+    proc.wait()
+    total_ms = (time.perf_counter() - start) * 1000
+    if proc.returncode != 0 or not first:
+        raise SystemExit(f"CLI failed ({' '.join(flags) or 'full'}):\n{stderr}")
+    imported = json.loads(stderr.strip().splitlines()[-1])
+    return first_byte_ms, total_ms, imported
+
+
+def main() -> None:
+    args = parse_args()
+    # Offline and keyless so only import and local analysis time is measured.
+    env = {
+        **os.environ,
+        "GROQ_API_KEY": "",
+        "CODEFORESIGHT_LLM_BACKEND": "groq",
+        "PYTHONPATH": os.pathsep.join(filter(None, [str(PROJECT_ROOT / "src"), os.getenv("PYTHONPATH")])),
+    }
+    results = {}
+    over_budget = []
+    for mode in args.modes:
+        runs = [_cold_start(MODES[mode], args.input, env) for _ in range(args.runs)]
+        first_byte = [run[0] for run in runs]
+        results[mode] = {
+            "first_byte_ms_median": round(statistics.median(first_byte), 1),
+            "first_byte_ms_min": round(min(first_byte), 1),
+            "exit_ms_median": round(statistics.median(run[1] for run in runs), 1),
+            "heavy_imports": runs[-1][2],
+        }
+        print(
+            f"{mode:<9} first byte {results[mode]['first_byte_ms_median']:>8.1f} ms (median)"
+            f"  min {results[mode]['first_byte_ms_min']:>8.1f} ms"
+            f"  imports: {', '.join(runs[-1][2]) or '-'}"
+        )
+        if args.budget_ms is not None and results[mode]["first_byte_ms_median"] > args.budget_ms:
+            over_budget.append(mode)
+
+    if args.out:
+        Path(args.out).write_text(json.dumps(results, indent=2), encoding="utf-8")
+    if over_budget:
+        raise SystemExit(f"Over {args.budget_ms:.0f} ms budget: {', '.join(over_budget)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,45 @@
+from __future__ import annotations
+
+import argparse
+import time
+
+from codeforesight.config import CURATED_PAIRS_DIR, STAGE1_CLONE_INDEX_PATH
+from codeforesight.data.curated_pairs import iter_curated_pairs
+from codeforesight.stages.stage1_clones import build_clone_index, find_clones, save_clone_index
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Build the MinHash/LSH index of functions changed by CVE fixes")
+    parser.add_argument("--language", choices=["c", "other"], default=None, help="Index one language only")
+    parser.add_argument(
+        "--check",
+        default=None,
+        help="Source file to look up against the new index (prints matches and lookup time)",
+    )
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    start = time.perf_counter()
+    index = build_clone_index(iter_curated_pairs(CURATED_PAIRS_DIR, language=args.language))
+    save_clone_index(index, STAGE1_CLONE_INDEX_PATH)
+    cves = {entry[0] for entry in index.entries}
+    print(
+        f"Indexed {len(index.entries)} functions from {len(cves)} CVEs "
+        f"in {time.perf_counter() - start:.1f}s -> {STAGE1_CLONE_INDEX_PATH}"
+    )
+
+    if args.check:
+        with open(args.check, encoding="utf-8", errors="ignore") as f:
+            code = f.read()
+        start = time.perf_counter()
+        matches = find_clones(code, args.check, index=index)
+        elapsed_ms = (time.perf_counter() - start) * 1000
+        for match in matches:
+            print(f"{match.name}:{match.line} ~ {match.cve_id} {match.path}:{match.function} ({match.similarity:.2f})")
+        print(f"Lookup: {elapsed_ms:.2f} ms")
+
+
+if __name__ == "__main__":
+    main()
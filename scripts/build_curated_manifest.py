@@ -1,19 +1,62 @@
 from __future__ import annotations
 
-import json
-from dataclasses import asdict
+import argparse
+import shutil
 
-from codeforesight.config import CURATED_PAIRS_DIR, PROCESSED_DIR
-from codeforesight.data.curated_pairs import iter_curated_pairs
+from codeforesight.config import CURATED_PAIRS_DIR, NVD_DIR
+from codeforesight.data.blob_store import BlobStore
+from codeforesight.data.curated_pairs import (
+    curated_blob_root,
+    curated_index_path,
+    ingest_unindexed_pairs,
+    legacy_manifest_path,
+    open_index,
+)
+from codeforesight.data.stage1_dataset import build_cve_to_cwe
+from codeforesight.stages.label_utils import map_cwe_to_group
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Build the indexed curated-pair manifest")
+    parser.add_argument(
+        "--prune-trees",
+        action="store_true",
+        help="Delete before/after trees once their files are in the blob store",
+    )
+    return parser.parse_args()
 
 
 def main() -> None:
-    PROCESSED_DIR.mkdir(parents=True, exist_ok=True)
-    out_path = PROCESSED_DIR / "curated_manifest.json"
+    args = parse_args()
+    store = BlobStore(curated_blob_root(CURATED_PAIRS_DIR))
+    cve_to_cwe = build_cve_to_cwe(NVD_DIR)
+    index_path = curated_index_path(CURATED_PAIRS_DIR)
+    conn = open_index(index_path)
+    with conn:
+        result = ingest_unindexed_pairs(conn, CURATED_PAIRS_DIR, store, cve_to_cwe)
+        # NVD CWE assignments change over time; keep every indexed pair current.
+        conn.executemany(
+            "UPDATE pairs SET cwe_id = ?, cwe_group = ? WHERE cve_id = ?",
+            [(cwe, map_cwe_to_group(cwe), cve_id) for cve_id, cwe in cve_to_cwe.items()],
+        )
+    total = conn.execute("SELECT COUNT(*) FROM pairs").fetchone()[0]
+    conn.execute("VACUUM")
+    conn.close()
+
+    if legacy_manifest_path(CURATED_PAIRS_DIR).exists():
+        legacy_manifest_path(CURATED_PAIRS_DIR).unlink()
+    if args.prune_trees:
+        # Only after the index that references the blobs is committed.
+        for pair_dir in result.pair_dirs:
+            shutil.rmtree(pair_dir)
 
-    records = [asdict(r) for r in iter_curated_pairs(CURATED_PAIRS_DIR)]
-    out_path.write_text(json.dumps(records), encoding="utf-8")
-    print(f"Wrote {len(records)} curated records to {out_path}")
+    print(f"Indexed {result.pairs} new pairs; {total} pairs in {index_path}")
+    if result.files:
+        stored_bytes = sum(store.stored_size(blob_id) for blob_id in result.blob_ids)
+        print(
+            f"{result.files} files -> {len(result.blob_ids)} unique blobs, "
+            f"{result.raw_bytes} -> {stored_bytes} bytes"
+        )
 
 
 if __name__ == "__main__":
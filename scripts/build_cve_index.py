@@ -3,18 +3,23 @@ from __future__ import annotations
 import json
 from dataclasses import asdict
 
-from codeforesight.config import NVD_DIR, PROCESSED_DIR
+from codeforesight.config import CVE_INDEX_PATH, CVE_TEXT_INDEX_DIR, NVD_DIR, PROCESSED_DIR
+from codeforesight.data.cve_text_index import CveTextIndex
 from codeforesight.data.nvd_loader import iter_nvd_records
 
 
 def main() -> None:
     PROCESSED_DIR.mkdir(parents=True, exist_ok=True)
-    out_path = PROCESSED_DIR / "cve_index.json"
+    out_path = CVE_INDEX_PATH
 
-    records = [asdict(r) for r in iter_nvd_records(NVD_DIR)]
-    out_path.write_text(json.dumps(records), encoding="utf-8")
+    records = list(iter_nvd_records(NVD_DIR))
+    out_path.write_text(json.dumps([asdict(r) for r in records]), encoding="utf-8")
     print(f"Wrote {len(records)} CVE records to {out_path}")
 
+    text_index = CveTextIndex.build(records)
+    text_index.save(CVE_TEXT_INDEX_DIR)
+    print(f"Indexed {len(text_index.terms)} terms, {len(text_index.doc_ids)} postings in {CVE_TEXT_INDEX_DIR}")
+
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,45 @@
+from __future__ import annotations
+
+import argparse
+import time
+
+import numpy as np
+
+from codeforesight.config import CURATED_PAIRS_DIR, STAGE1_SIMILAR_INDEX_DIR
+from codeforesight.data.curated_pairs import iter_curated_pairs
+from codeforesight.stages.stage1_similar import build_similar_index, embed_code
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Build the nearest-neighbour index of curated CVE fixes")
+    parser.add_argument("--language", choices=["c", "other"], default=None, help="Index one language only")
+    parser.add_argument("--bench", type=int, default=200, help="Random queries timed after the build (0 to skip)")
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    start = time.perf_counter()
+    index = build_similar_index(iter_curated_pairs(CURATED_PAIRS_DIR, language=args.language))
+    if index is None:
+        print("No curated functions to index.")
+        return
+    index.save(STAGE1_SIMILAR_INDEX_DIR)
+    print(
+        f"Indexed {len(index.entries)} functions in {len(index.centroids)} lists "
+        f"in {time.perf_counter() - start:.1f}s -> {STAGE1_SIMILAR_INDEX_DIR}"
+    )
+
+    if args.bench:
+        rng = np.random.RandomState(0)
+        queries = [embed_code(" ".join(rng.choice(["if", "len", "buf", "memcpy", "(", ")", ";"], 40)))]
+        queries += [index.vectors[i] for i in rng.randint(0, len(index.entries), size=args.bench - 1)]
+        start = time.perf_counter()
+        for query in queries:
+            index.search(np.asarray(query))
+        elapsed_ms = (time.perf_counter() - start) * 1000 / len(queries)
+        print(f"Mean query latency: {elapsed_ms:.3f} ms")
+
+
+if __name__ == "__main__":
+    main()
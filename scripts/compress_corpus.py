@@ -0,0 +1,74 @@
+from __future__ import annotations
+
+import argparse
+import os
+import random
+
+from codeforesight.config import CURATED_PAIRS_DIR, NVD_DIR
+from codeforesight.data.blob_store import BlobStore
+from codeforesight.data.curated_pairs import curated_blob_root
+from codeforesight.data.zstd_io import compress_file, compressed_path, train_dictionary, zstd_available
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="zstd-compress NVD feeds and curated blobs")
+    parser.add_argument("--level", type=int, default=19, help="zstd compression level")
+    parser.add_argument(
+        "--train-dict",
+        action="store_true",
+        help="Train a new source-code dictionary even if one is already active",
+    )
+    parser.add_argument("--dict-size", type=int, default=112 * 1024, help="Dictionary size in bytes")
+    parser.add_argument("--dict-samples", type=int, default=5000, help="Blobs sampled to train the dictionary")
+    parser.add_argument("--skip-nvd", action="store_true", help="Leave NVD year feeds untouched")
+    return parser.parse_args()
+
+
+def _compress_nvd(level: int) -> tuple[int, int]:
+    before = after = 0
+    for path in sorted(NVD_DIR.glob("*.json")):
+        out_path = compressed_path(path)
+        tmp_path = out_path.with_name(out_path.name + ".tmp")
+        compress_file(path, tmp_path, level=level)
+        before += path.stat().st_size
+        after += tmp_path.stat().st_size
+        os.replace(tmp_path, out_path)
+        path.unlink()
+    return before, after
+
+
+def _train(store: BlobStore, dict_size: int, sample_count: int) -> int:
+    raw_ids = list(store.iter_ids(compressed=False))
+    rng = random.Random(0)
+    samples = [store.get(blob_id) for blob_id in rng.sample(raw_ids, min(sample_count, len(raw_ids)))]
+    dictionary = train_dictionary(samples, dict_size=dict_size) if samples else None
+    # Id 0 means plain zstd: too few blobs to train on yet.
+    dict_id = store.dictionaries.save(dictionary) if dictionary is not None else 0
+    store.set_active_dictionary(dict_id)
+    return dict_id
+
+
+def main() -> None:
+    args = parse_args()
+    if not zstd_available():
+        raise SystemExit("Install the 'zstandard' package to compress the corpus.")
+
+    if not args.skip_nvd:
+        before, after = _compress_nvd(args.level)
+        if before:
+            print(f"NVD feeds: {before} -> {after} bytes")
+
+    store = BlobStore(curated_blob_root(CURATED_PAIRS_DIR))
+    if args.train_dict or store.active_dictionary_id() is None:
+        dict_id = _train(store, args.dict_size, args.dict_samples)
+        print(f"Trained dictionary {dict_id}" if dict_id else "Too few blobs for a dictionary; using plain zstd")
+
+    count = saved = 0
+    for blob_id in list(store.iter_ids(compressed=False)):
+        saved += store.compress(blob_id, level=args.level)
+        count += 1
+    print(f"Compressed {count} blobs, saved {saved} bytes")
+
+
+if __name__ == "__main__":
+    main()
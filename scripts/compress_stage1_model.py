@@ -0,0 +1,47 @@
+from __future__ import annotations
+
+import argparse
+
+from codeforesight.config import (
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_MODEL_C_PATH,
+    STAGE1_MODEL_OTHER_PATH,
+)
+from codeforesight.stages.stage1_compress import DEFAULT_KEEP_MASS, compress_stage1_model
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Prune and int8-quantize Stage 1 models")
+    parser.add_argument(
+        "--keep-mass",
+        type=float,
+        default=DEFAULT_KEEP_MASS,
+        help="Fraction of each class's L1 weight mass to keep after pruning",
+    )
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    targets = [
+        ("C/C++", STAGE1_MODEL_C_PATH, STAGE1_COMPRESSED_MODEL_C_PATH),
+        ("Other", STAGE1_MODEL_OTHER_PATH, STAGE1_COMPRESSED_MODEL_OTHER_PATH),
+    ]
+    compressed_any = False
+    for name, model_path, out_path in targets:
+        if not model_path.exists():
+            continue
+        stats = compress_stage1_model(model_path, out_path, keep_mass=args.keep_mass)
+        compressed_any = True
+        print(
+            f"{name}: kept {stats['kept_weights']}/{stats['total_weights']} weights "
+            f"({stats['density']:.2%}), {stats['original_bytes']} -> {stats['compressed_bytes']} bytes"
+        )
+    if not compressed_any:
+        raise SystemExit("Stage 1 models not found. Run scripts/train_stage1_model.py first.")
+    print("Run scripts/evaluate_stage1_model.py --compare-compressed to check the accuracy delta.")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,131 +1,276 @@
 from __future__ import annotations
 
+import argparse
+import hashlib
+import json
+import os
+import time
 from collections import defaultdict
+from concurrent.futures import ProcessPoolExecutor
 from pathlib import Path
 
 from codeforesight.config import (
     CURATED_PAIRS_DIR,
     NVD_DIR,
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_EVAL_CACHE_PATH,
     STAGE1_LABELS_C_PATH,
     STAGE1_LABELS_OTHER_PATH,
     STAGE1_MODEL_C_PATH,
     STAGE1_MODEL_OTHER_PATH,
 )
 from codeforesight.data.curated_pairs import iter_curated_pairs
-from codeforesight.data.nvd_loader import iter_nvd_records
+from codeforesight.data.shared_models import enable_shared_models
+from codeforesight.data.stage1_dataset import build_cve_to_cwe, chunk_text
 from codeforesight.stages.label_utils import map_cwe_to_group
 from codeforesight.stages.language_utils import detect_language
-from codeforesight.stages.stage1_model import load_stage1_model
+from codeforesight.stages.stage1_model import load_stage1_config, load_stage1_model
 
 
-def _build_cve_to_cwe(nvd_dir: Path) -> dict[str, str]:
-    mapping: dict[str, str] = {}
-    for record in iter_nvd_records(nvd_dir):
-        if not record.cve_id:
-            continue
-        if record.cwe_ids:
-            mapping[record.cve_id] = record.cwe_ids[0]
-    return mapping
-
-
-def _read_text(path: Path) -> str:
-    return path.read_text(encoding="utf-8", errors="ignore")
-
-
-def _chunk_text(text: str, lines_per_chunk: int = 40, stride: int = 20, max_chunks: int = 20) -> list[str]:
-    lines = text.splitlines()
-    if not lines:
-        return []
-    if len(lines) <= lines_per_chunk:
-        return [text]
-    chunks: list[str] = []
-    for start in range(0, len(lines), stride):
-        end = start + lines_per_chunk
-        chunk = "\n".join(lines[start:end]).strip()
-        if chunk:
-            chunks.append(chunk)
-        if len(chunks) >= max_chunks:
-            break
-    return chunks
-
-
-def _predict_with_threshold(model, code: str, labels: list[str]) -> str:
-    probs = model.predict_proba([code])[0]
-    max_idx = int(probs.argmax())
-    label = labels[max_idx]
-    confidence = float(probs[max_idx])
-    if label != "SAFE" and confidence < 0.6:
-        return "SAFE"
-    return label
-
-
-def _load_models() -> dict[str, tuple]:
-    models: dict[str, tuple] = {}
-    if STAGE1_MODEL_C_PATH.exists() and STAGE1_LABELS_C_PATH.exists():
-        models["c"] = load_stage1_model(STAGE1_MODEL_C_PATH, STAGE1_LABELS_C_PATH)
-    if STAGE1_MODEL_OTHER_PATH.exists() and STAGE1_LABELS_OTHER_PATH.exists():
-        models["other"] = load_stage1_model(STAGE1_MODEL_OTHER_PATH, STAGE1_LABELS_OTHER_PATH)
-    return models
+def _predict_batch_with_threshold(
+    model,
+    chunks: list[str],
+    labels: list[str],
+    threshold: float = 0.6,
+) -> list[str]:
+    preds: list[str] = []
+    for probs in model.predict_proba(chunks):
+        max_idx = int(probs.argmax())
+        label = labels[max_idx]
+        if label != "SAFE" and float(probs[max_idx]) < threshold:
+            label = "SAFE"
+        preds.append(label)
+    return preds
 
 
-def main() -> None:
-    models = _load_models()
-    if not models:
-        raise SystemExit("Stage 1 models not found. Run scripts/train_stage1_model.py first.")
+def _file_digest(path: Path) -> str:
+    digest = hashlib.sha256()
+    with path.open("rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+def _model_specs(compressed: bool = False) -> dict[str, tuple]:
+    """language -> (model path, labels path, model hash, threshold) for every trained model."""
+    model_c_path = STAGE1_COMPRESSED_MODEL_C_PATH if compressed else STAGE1_MODEL_C_PATH
+    model_other_path = STAGE1_COMPRESSED_MODEL_OTHER_PATH if compressed else STAGE1_MODEL_OTHER_PATH
+    specs: dict[str, tuple] = {}
+    for lang, model_path, labels_path in (
+        ("c", model_c_path, STAGE1_LABELS_C_PATH),
+        ("other", model_other_path, STAGE1_LABELS_OTHER_PATH),
+    ):
+        if model_path.exists() and labels_path.exists():
+            threshold = float(load_stage1_config(lang)["threshold"])
+            specs[lang] = (model_path, labels_path, f"{_file_digest(model_path)}@{threshold}", threshold)
+    return specs
+
+
+class _PredictionCache:
+    """Thresholded predictions keyed by model hash, then chunk hash."""
+
+    def __init__(self, path: Path | None):
+        self.path = path
+        self.entries: dict[str, dict[str, str]] = {}
+        self.dirty = False
+        if path and path.exists():
+            try:
+                self.entries = json.loads(path.read_text(encoding="utf-8"))
+            except json.JSONDecodeError:
+                self.entries = {}
+
+    def put_many(self, model_hash: str, items: dict[str, str]) -> None:
+        if not items:
+            return
+        self.entries.setdefault(model_hash, {}).update(items)
+        self.dirty = True
+
+    def save(self, keep: set[str]) -> None:
+        """Write the cache, dropping predictions of models that no longer exist."""
+        stale = set(self.entries) - keep
+        if not self.path or not (self.dirty or stale):
+            return
+        for model_hash in stale:
+            del self.entries[model_hash]
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        tmp_path = self.path.with_suffix(".tmp")
+        tmp_path.write_text(json.dumps(self.entries), encoding="utf-8")
+        os.replace(tmp_path, self.path)
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Evaluate Stage 1 classifiers on curated pairs")
+    parser.add_argument(
+        "--compare-compressed",
+        action="store_true",
+        help="Also evaluate the quantized models and report the accuracy delta",
+    )
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="Files evaluated concurrently",
+    )
+    parser.add_argument("--no-cache", action="store_true", help="Ignore and do not update the prediction cache")
+    return parser.parse_args()
+
+
+def _collect_jobs(models: dict[str, tuple], cve_to_cwe: dict[str, str]) -> list[tuple]:
+    jobs: list[tuple] = []
+    for pair in iter_curated_pairs(CURATED_PAIRS_DIR):
+        vuln_label = map_cwe_to_group(cve_to_cwe.get(pair.cve_id, ""))
+        for side, true_label in (("before", vuln_label), ("after", "SAFE")):
+            for rel_path in pair.list_files(side):
+                lang = detect_language(Path(rel_path))
+                if lang in models:
+                    jobs.append((pair, side, rel_path, lang, true_label))
+    return jobs
+
+
+# Per worker process: loaded models and a read-only copy of the cache for them.
+_WORKER_MODELS: dict[str, tuple] = {}
+_WORKER_CACHE: dict[str, dict[str, str]] = {}
+
+
+def _init_worker(specs: dict[str, tuple], cached: dict[str, dict[str, str]]) -> None:
+    global _WORKER_MODELS, _WORKER_CACHE
+    _WORKER_MODELS = {}
+    for lang, (model_path, labels_path, model_hash, threshold) in specs.items():
+        model, labels = load_stage1_model(model_path, labels_path)
+        _WORKER_MODELS[lang] = (model, labels, model_hash, threshold)
+    _WORKER_CACHE = cached
 
-    cve_to_cwe = _build_cve_to_cwe(NVD_DIR)
+
+def _evaluate_file(job: tuple) -> tuple[str, str, list[str], list[float], dict[str, str]]:
+    """Predictions for one file, its per-chunk latencies and the newly computed cache entries."""
+    pair, side, rel_path, lang, true_label = job
+    model, labels, model_hash, threshold = _WORKER_MODELS[lang]
+    chunks = chunk_text(pair.read_text(side, rel_path))
+    hashes = [hashlib.sha1(chunk.encode("utf-8")).hexdigest() for chunk in chunks]
+
+    cached = _WORKER_CACHE.get(model_hash, {})
+    preds: list[str | None] = [cached.get(h) for h in hashes]
+    missing = [idx for idx, pred in enumerate(preds) if pred is None]
+    latencies: list[float] = []
+    computed: dict[str, str] = {}
+    if missing:
+        batch: list[str] = []
+        # One call per chunk, so p50/p99 are real per-chunk latencies rather than a file's mean.
+        for idx in missing:
+            started = time.perf_counter()
+            batch.extend(_predict_batch_with_threshold(model, [chunks[idx]], labels, threshold=threshold))
+            latencies.append(time.perf_counter() - started)
+        for idx, pred in zip(missing, batch):
+            preds[idx] = pred
+        computed = {hashes[idx]: pred for idx, pred in zip(missing, batch)}
+    return lang, true_label, [p for p in preds if p is not None], latencies, computed
+
+
+def _percentile(values: list[float], pct: float) -> float:
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = min(len(ordered) - 1, max(0, int(round(pct / 100 * (len(ordered) - 1)))))
+    return ordered[rank]
+
+
+def _evaluate(
+    specs: dict[str, tuple],
+    cve_to_cwe: dict[str, str],
+    workers: int = 1,
+    cache: _PredictionCache | None = None,
+) -> dict:
+    cache = cache or _PredictionCache(None)
+    jobs = _collect_jobs(specs, cve_to_cwe)
+    cached = {spec[2]: cache.entries.get(spec[2], {}) for spec in specs.values()}
     per_lang = {"c": {"total": 0, "correct": 0}, "other": {"total": 0, "correct": 0}}
 
     y_true = []
     y_pred = []
     per_label = defaultdict(lambda: {"correct": 0, "total": 0})
     confusion = defaultdict(int)
+    latencies: list[float] = []
 
-    for pair in iter_curated_pairs(CURATED_PAIRS_DIR):
-        cwe = cve_to_cwe.get(pair.cve_id, "")
-        vuln_label = map_cwe_to_group(cwe)
-
-        for file_path in pair.before_dir.rglob("*"):
-            if not file_path.is_file():
-                continue
-            lang = detect_language(file_path)
-            if lang not in models:
-                continue
-            model, labels = models[lang]
-            for chunk in _chunk_text(_read_text(file_path)):
-                pred = _predict_with_threshold(model, chunk, labels)
-                y_true.append(vuln_label)
-                y_pred.append(pred)
-                per_label[vuln_label]["total"] += 1
-                per_label[vuln_label]["correct"] += int(pred == vuln_label)
-                confusion[(vuln_label, pred)] += 1
-                per_lang[lang]["total"] += 1
-                per_lang[lang]["correct"] += int(pred == vuln_label)
-
-        for file_path in pair.after_dir.rglob("*"):
-            if not file_path.is_file():
-                continue
-            lang = detect_language(file_path)
-            if lang not in models:
-                continue
-            model, labels = models[lang]
-            for chunk in _chunk_text(_read_text(file_path)):
-                pred = _predict_with_threshold(model, chunk, labels)
-                y_true.append("SAFE")
-                y_pred.append(pred)
-                per_label["SAFE"]["total"] += 1
-                per_label["SAFE"]["correct"] += int(pred == "SAFE")
-                confusion[("SAFE", pred)] += 1
-                per_lang[lang]["total"] += 1
-                per_lang[lang]["correct"] += int(pred == "SAFE")
+    def _results():
+        if workers <= 1:
+            _init_worker(specs, cached)
+            yield from map(_evaluate_file, jobs)
+            return
+        # The vectorizer analyzers are pure Python and hold the GIL, so scale with
+        # processes; models are memory-mapped so workers share one copy.
+        enable_shared_models()
+        with ProcessPoolExecutor(max_workers=workers, initializer=_init_worker, initargs=(specs, cached)) as pool:
+            # map() keeps job order, so results are identical for any worker count.
+            yield from pool.map(_evaluate_file, jobs, chunksize=max(1, len(jobs) // (workers * 8)))
+
+    started = time.perf_counter()
+    for lang, true_label, preds, file_latencies, computed in _results():
+        cache.put_many(specs[lang][2], computed)
+        latencies.extend(file_latencies)
+        for pred in preds:
+            y_true.append(true_label)
+            y_pred.append(pred)
+            per_label[true_label]["total"] += 1
+            per_label[true_label]["correct"] += int(pred == true_label)
+            confusion[(true_label, pred)] += 1
+            per_lang[lang]["total"] += 1
+            per_lang[lang]["correct"] += int(pred == true_label)
+    elapsed = time.perf_counter() - started
+
+    return {
+        "y_true": y_true,
+        "y_pred": y_pred,
+        "per_label": per_label,
+        "confusion": confusion,
+        "per_lang": per_lang,
+        "elapsed": elapsed,
+        "latencies": latencies,
+        # Every chunk without a latency came from the cache.
+        "cache_hits": len(y_true) - len(latencies),
+    }
+
+
+def _accuracy(result: dict) -> float:
+    total = len(result["y_true"])
+    correct = sum(1 for t, p in zip(result["y_true"], result["y_pred"]) if t == p)
+    return (correct / total) if total else 0.0
+
+
+def main() -> None:
+    args = parse_args()
+    specs = _model_specs()
+    if not specs:
+        raise SystemExit("Stage 1 models not found. Run scripts/train_stage1_model.py first.")
+    compressed_specs = _model_specs(compressed=True)
+    current_hashes = {spec[2] for spec in [*specs.values(), *compressed_specs.values()]}
+
+    cve_to_cwe = build_cve_to_cwe(NVD_DIR)
+    cache = _PredictionCache(None if args.no_cache else STAGE1_EVAL_CACHE_PATH)
+    result = _evaluate(specs, cve_to_cwe, workers=args.workers, cache=cache)
+    y_true = result["y_true"]
+    per_label = result["per_label"]
+    confusion = result["confusion"]
+    per_lang = result["per_lang"]
 
     total = len(y_true)
-    correct = sum(1 for t, p in zip(y_true, y_pred) if t == p)
-    accuracy = (correct / total) if total else 0.0
+    accuracy = _accuracy(result)
+
+    latencies = result["latencies"]
+    throughput = len(latencies) / result["elapsed"] if result["elapsed"] > 0 else 0.0
 
     print("Stage 1 evaluation")
     print(f"Total samples: {total}")
     print(f"Accuracy: {accuracy:.2%}")
+    print(
+        f"Throughput: {throughput:.1f} predicted chunks/s "
+        f"({len(latencies)} predicted, {result['elapsed']:.2f}s, {args.workers} workers)"
+    )
+    print(
+        f"Per-chunk latency: p50={_percentile(latencies, 50) * 1000:.3f} ms, "
+        f"p99={_percentile(latencies, 99) * 1000:.3f} ms over {len(latencies)} predicted chunks"
+    )
+    print(f"Cache hits: {result['cache_hits']}/{total} (not counted in throughput)")
     print("")
     print("Per-label accuracy:")
     for label, stats in sorted(per_label.items()):
@@ -158,6 +303,24 @@ def main() -> None:
         acc = stats["correct"] / stats["total"]
         print(f"- {lang}: {acc:.2%} ({stats['correct']}/{stats['total']})")
 
+    if args.compare_compressed:
+        print("")
+        if not compressed_specs:
+            print("Compressed models not found. Run scripts/compress_stage1_model.py first.")
+            cache.save(keep=current_hashes)
+            return
+        compressed_result = _evaluate(compressed_specs, cve_to_cwe, workers=args.workers, cache=cache)
+        compressed_accuracy = _accuracy(compressed_result)
+        delta = (compressed_accuracy - accuracy) * 100
+        print(f"Compressed accuracy: {compressed_accuracy:.2%} (delta {delta:+.2f} pp)")
+        compressed_latencies = compressed_result["latencies"]
+        print(
+            f"Compressed per-chunk latency: p50={_percentile(compressed_latencies, 50) * 1000:.3f} ms, "
+            f"p99={_percentile(compressed_latencies, 99) * 1000:.3f} ms"
+        )
+
+    cache.save(keep=current_hashes)
+
 
 if __name__ == "__main__":
     main()
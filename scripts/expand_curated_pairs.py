@@ -1,24 +1,245 @@
 from __future__ import annotations
 
 import argparse
-import json
 import re
 import subprocess
+import threading
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
+from typing import Any, Dict, List, Set, Tuple
 
 from codeforesight.config import CURATED_PAIRS_DIR, NVD_DIR
+from codeforesight.data.blob_store import BlobStore
+from codeforesight.data.curated_pairs import (
+    ManifestFile,
+    add_pair,
+    curated_blob_root,
+    curated_index_path,
+    indexed_pair_keys,
+    ingest_unindexed_pairs,
+    iter_tree_pairs,
+    legacy_manifest_path,
+    load_legacy_manifest,
+    open_index,
+)
+from codeforesight.data.nvd_loader import iter_nvd_records
+
+
+_NULL_OID = "0" * 40
 
 
 def parse_args() -> argparse.Namespace:
     parser = argparse.ArgumentParser(description="Expand curated CVE commit pairs")
     parser.add_argument("--max", type=int, default=50, help="Target number of pairs")
+    parser.add_argument("--workers", type=int, default=8, help="Repositories processed concurrently")
     return parser.parse_args()
 
 
+class _Budget:
+    """Pair slots shared by all workers so the run stops at the target."""
+
+    def __init__(self, remaining: int):
+        self.remaining = remaining
+        self.collected = 0
+        self._lock = threading.Lock()
+
+    def acquire(self) -> bool:
+        with self._lock:
+            if self.remaining <= 0:
+                return False
+            self.remaining -= 1
+            return True
+
+    def release(self, used: bool) -> None:
+        with self._lock:
+            if used:
+                self.collected += 1
+            else:
+                self.remaining += 1
+
+    def exhausted(self) -> bool:
+        with self._lock:
+            return self.remaining <= 0
+
+
+class _CatFileBatch:
+    """One long-lived `git cat-file --batch` process serving every blob read for a repo."""
+
+    def __init__(self, repo_dir: Path):
+        self._proc = subprocess.Popen(
+            ["git", "-C", str(repo_dir), "cat-file", "--batch"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+        )
+
+    def read(self, oid: str) -> bytes | None:
+        assert self._proc.stdin and self._proc.stdout
+        self._proc.stdin.write(oid.encode("ascii") + b"\n")
+        self._proc.stdin.flush()
+        header = self._proc.stdout.readline().split()
+        if len(header) != 3:
+            # "<oid> missing" or an ambiguous name: no payload follows.
+            return None
+        data = self._proc.stdout.read(int(header[2]))
+        self._proc.stdout.read(1)
+        return data
+
+    def close(self) -> None:
+        if self._proc.stdin:
+            self._proc.stdin.close()
+        self._proc.wait()
+
+
+def _git(repo_dir: Path, *args: str, stdin: str | None = None) -> subprocess.CompletedProcess:
+    return subprocess.run(
+        ["git", "-C", str(repo_dir), *args],
+        input=stdin,
+        check=True,
+        capture_output=True,
+        text=True,
+    )
+
+
+def _has_commit(repo_dir: Path, sha: str) -> bool:
+    result = subprocess.run(
+        ["git", "-C", str(repo_dir), "cat-file", "-e", f"{sha}^{{commit}}"],
+        capture_output=True,
+    )
+    return result.returncode == 0
+
+
+def _ensure_clone(repo_dir: Path, owner: str, repo: str) -> bool:
+    if (repo_dir / "HEAD").exists() or (repo_dir / ".git").exists():
+        return True
+    try:
+        subprocess.run(
+            [
+                "git",
+                "clone",
+                "--filter=blob:none",
+                "--no-checkout",
+                f"https://github.com/{owner}/{repo}.git",
+                str(repo_dir),
+            ],
+            check=True,
+            capture_output=True,
+        )
+    except subprocess.CalledProcessError:
+        return False
+    return True
+
+
+def _changed_blobs(repo_dir: Path, sha: str) -> List[Tuple[str, str, str]]:
+    """(path, before oid, after oid) for modified files, read from trees only."""
+    result = _git(repo_dir, "diff-tree", "-r", "--no-renames", "--no-commit-id", f"{sha}^", sha)
+    changed = []
+    for line in result.stdout.splitlines():
+        meta, _, path = line.partition("\t")
+        fields = meta.split()
+        if len(fields) < 5 or not path:
+            continue
+        before_oid, after_oid = fields[2], fields[3]
+        if before_oid == _NULL_OID or after_oid == _NULL_OID:
+            continue
+        changed.append((path, before_oid, after_oid))
+    return changed
+
+
+def _prefetch_blobs(repo_dir: Path, oids: List[str]) -> None:
+    """Fetch all missing blobs of a blob:none clone in one request instead of one per file."""
+    try:
+        _git(
+            repo_dir,
+            "-c",
+            "fetch.negotiationAlgorithm=noop",
+            "fetch",
+            "origin",
+            "--no-tags",
+            "--no-write-fetch-head",
+            "--recurse-submodules=no",
+            "--filter=blob:none",
+            "--stdin",
+            stdin="\n".join(oids) + "\n",
+        )
+    except subprocess.CalledProcessError:
+        # cat-file will still lazily fetch whatever is missing.
+        pass
+
+
+def _store_pair(
+    store: BlobStore,
+    cve_id: str,
+    repo_slug: str,
+    url: str,
+    cwe_id: str,
+    blobs: List[Tuple[str, bytes, bytes]],
+) -> Dict[str, Any]:
+    files = [
+        ManifestFile(file_path, store.put(before), store.put(after), len(before), len(after))
+        for file_path, before, after in blobs
+    ]
+    return {"cve_id": cve_id, "repo_slug": repo_slug, "commit": url, "cwe_id": cwe_id, "files": files}
+
+
+def _process_repo(
+    owner: str,
+    repo: str,
+    entries: List[Tuple[str, str, str, str]],
+    repos_dir: Path,
+    budget: _Budget,
+    existing: Set[Tuple[str, str]],
+    store: BlobStore,
+) -> List[Dict[str, Any]]:
+    stored: List[Dict[str, Any]] = []
+    if budget.exhausted():
+        return stored
+    repo_dir = repos_dir / f"{owner}_{repo}"
+    if not _ensure_clone(repo_dir, owner, repo):
+        return stored
+
+    reader = _CatFileBatch(repo_dir)
+    try:
+        for cve_id, url, sha, cwe_id in entries:
+            repo_slug = f"{owner}_{repo}_{sha[:7]}"
+            if (cve_id, repo_slug) in existing:
+                continue
+            if not budget.acquire():
+                return stored
+            used = False
+            try:
+                if not (_has_commit(repo_dir, sha) and _has_commit(repo_dir, f"{sha}^")):
+                    _git(repo_dir, "fetch", "--depth", "2", "origin", sha)
+                changed = _changed_blobs(repo_dir, sha)[:10]
+                if not changed:
+                    continue
+                _prefetch_blobs(repo_dir, [oid for _, b, a in changed for oid in (b, a)])
+
+                blobs = []
+                for file_path, before_oid, after_oid in changed:
+                    before = reader.read(before_oid)
+                    after = reader.read(after_oid)
+                    if before is None or after is None:
+                        continue
+                    if b"\x00" in before or b"\x00" in after:
+                        continue
+                    blobs.append((file_path, before, after))
+                if blobs:
+                    stored.append(_store_pair(store, cve_id, repo_slug, url, cwe_id, blobs))
+                    used = True
+            except subprocess.CalledProcessError:
+                continue
+            finally:
+                budget.release(used)
+    finally:
+        reader.close()
+    return stored
+
+
 def main() -> None:
     args = parse_args()
 
-    commit_re = re.compile(r"https://github\\.com/([^/]+)/([^/]+)/commit/([0-9a-fA-F]{7,40})")
+    commit_re = re.compile(r"https://github\.com/([^/]+)/([^/]+)/commit/([0-9a-fA-F]{7,40})")
     exclude_repos = {
         ("torvalds", "linux"),
         ("FFmpeg", "FFmpeg"),
@@ -34,105 +255,60 @@ def main() -> None:
     repos_dir = CURATED_PAIRS_DIR / "_repos"
     repos_dir.mkdir(parents=True, exist_ok=True)
 
-    commit_entries = []
-    for path in sorted(NVD_DIR.glob("*.json")):
-        with path.open("r", encoding="utf-8") as f:
-            data = json.load(f)
-        for item in data.get("vulnerabilities", []) or []:
-            cve = item.get("cve", {})
-            cve_id = cve.get("id")
-            for ref in cve.get("references", []) or []:
-                url = ref.get("url", "")
-                m = commit_re.match(url)
-                if m:
-                    owner, repo, sha = m.group(1), m.group(2), m.group(3)
-                    if (owner, repo) in exclude_repos:
-                        continue
-                    commit_entries.append((cve_id, url, owner, repo, sha))
-
+    # Group commits by repository so each clone is handled by a single worker.
     seen = set()
-    unique = []
-    for entry in commit_entries:
-        if entry[1] in seen:
-            continue
-        seen.add(entry[1])
-        unique.append(entry)
+    cve_to_cwe: Dict[str, str] = {}
+    by_repo: Dict[Tuple[str, str], List[Tuple[str, str, str, str]]] = {}
+    for record in iter_nvd_records(NVD_DIR):
+        cwe_id = record.cwe_ids[0] if record.cwe_ids else ""
+        cve_to_cwe[record.cve_id] = cwe_id
+        for url in record.references:
+            m = commit_re.match(url)
+            if not m or url in seen:
+                continue
+            owner, repo, sha = m.group(1), m.group(2), m.group(3)
+            if (owner, repo) in exclude_repos:
+                continue
+            seen.add(url)
+            by_repo.setdefault((owner, repo), []).append((record.cve_id, url, sha, cwe_id))
 
-    current_pairs = [p for p in CURATED_PAIRS_DIR.glob("CVE-*") if p.is_dir()]
-    current_count = sum(1 for _ in CURATED_PAIRS_DIR.glob("CVE-*/**/metadata.txt"))
+    existing = indexed_pair_keys(CURATED_PAIRS_DIR)
+    existing |= {(entry["cve_id"], entry["repo_slug"]) for entry in load_legacy_manifest(CURATED_PAIRS_DIR)}
+    existing |= {(pair.cve_id, pair.repo_slug) for pair in iter_tree_pairs(CURATED_PAIRS_DIR, skip=existing)}
+    current_count = len(existing)
     target = max(args.max, current_count)
+    budget = _Budget(target - current_count)
+    store = BlobStore(curated_blob_root(CURATED_PAIRS_DIR))
 
-    collected = 0
-    for cve_id, url, owner, repo, sha in unique:
-        if current_count + collected >= target:
-            break
-
-        pair_dir = CURATED_PAIRS_DIR / cve_id / f"{owner}_{repo}_{sha[:7]}"
-        if pair_dir.exists():
-            continue
+    new_entries: List[Dict[str, Any]] = []
+    with ThreadPoolExecutor(max_workers=max(1, args.workers)) as pool:
+        futures = [
+            pool.submit(_process_repo, owner, repo, entries, repos_dir, budget, existing, store)
+            for (owner, repo), entries in by_repo.items()
+        ]
+        for future in futures:
+            new_entries.extend(future.result())
 
-        repo_dir = repos_dir / f"{owner}_{repo}"
-        if not repo_dir.exists():
-            try:
-                subprocess.run(
-                    ["git", "clone", "--filter=blob:none", "--no-checkout", f"https://github.com/{owner}/{repo}.git", str(repo_dir)],
-                    check=True,
-                    capture_output=True,
+    if new_entries:
+        # Single writer: workers only return entries, the index is updated here.
+        conn = open_index(curated_index_path(CURATED_PAIRS_DIR))
+        with conn:
+            # Readers trust the index once it exists, so it must also hold the older pairs.
+            ingest_unindexed_pairs(conn, CURATED_PAIRS_DIR, store, cve_to_cwe)
+            for entry in new_entries:
+                add_pair(
+                    conn,
+                    entry["cve_id"],
+                    entry["repo_slug"],
+                    entry["commit"],
+                    entry["cwe_id"],
+                    entry["files"],
                 )
-            except subprocess.CalledProcessError:
-                continue
+        conn.close()
+        if legacy_manifest_path(CURATED_PAIRS_DIR).exists():
+            legacy_manifest_path(CURATED_PAIRS_DIR).unlink()
 
-        try:
-            subprocess.run(["git", "-C", str(repo_dir), "fetch", "--depth", "2", "origin", sha], check=True, capture_output=True)
-            result = subprocess.run(
-                ["git", "-C", str(repo_dir), "show", "--name-only", "--pretty=", sha],
-                check=True,
-                capture_output=True,
-                text=True,
-            )
-        except subprocess.CalledProcessError:
-            continue
-
-        files = [line.strip() for line in result.stdout.splitlines() if line.strip()]
-        if not files:
-            continue
-
-        before_dir = pair_dir / "before"
-        after_dir = pair_dir / "after"
-        before_dir.mkdir(parents=True, exist_ok=True)
-        after_dir.mkdir(parents=True, exist_ok=True)
-
-        kept_files = []
-        for file_path in files[:10]:
-            before = subprocess.run(["git", "-C", str(repo_dir), "show", f"{sha}^:{file_path}"], capture_output=True)
-            after = subprocess.run(["git", "-C", str(repo_dir), "show", f"{sha}:{file_path}"], capture_output=True)
-            if before.returncode != 0 or after.returncode != 0:
-                continue
-            if b"\x00" in before.stdout or b"\x00" in after.stdout:
-                continue
-            (before_dir / file_path).parent.mkdir(parents=True, exist_ok=True)
-            (after_dir / file_path).parent.mkdir(parents=True, exist_ok=True)
-            (before_dir / file_path).write_bytes(before.stdout)
-            (after_dir / file_path).write_bytes(after.stdout)
-            kept_files.append(file_path)
-
-        if kept_files:
-            meta = pair_dir / "metadata.txt"
-            meta.write_text(
-                "\n".join(
-                    [
-                        f"CVE: {cve_id}",
-                        f"Commit: {url}",
-                        f"Repo: https://github.com/{owner}/{repo}",
-                        "Files:",
-                        *kept_files,
-                    ]
-                ),
-                encoding="utf-8",
-            )
-            collected += 1
-
-    print(f"Added {collected} new pairs. Total now: {current_count + collected}")
+    print(f"Added {budget.collected} new pairs. Total now: {current_count + budget.collected}")
 
 
 if __name__ == "__main__":
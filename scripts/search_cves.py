@@ -0,0 +1,31 @@
+from __future__ import annotations
+
+import argparse
+import time
+
+from codeforesight.data.cve_text_index import load_cve_text_index
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Search CVE descriptions (BM25)")
+    parser.add_argument("query", help='Free-text query, e.g. "sprintf SQL"')
+    parser.add_argument("--top", type=int, default=10, help="Number of CVEs to return")
+    parser.add_argument("--all", action="store_true", help="Only CVEs mentioning every query term")
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    index = load_cve_text_index()
+    if index is None:
+        raise SystemExit("CVE text index not found; run scripts/build_cve_index.py first.")
+    start = time.perf_counter()
+    hits = index.search(args.query, k=args.top, require_all=args.all)
+    elapsed_ms = (time.perf_counter() - start) * 1000
+    for hit in hits:
+        print(f"{hit.cve_id}\t{hit.score:.3f}")
+    print(f"{len(hits)} results in {elapsed_ms:.2f} ms")
+
+
+if __name__ == "__main__":
+    main()
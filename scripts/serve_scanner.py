@@ -0,0 +1,65 @@
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+from codeforesight.config_env import load_dotenv
+from codeforesight.metrics import serve_metrics
+from codeforesight.service import DEFAULT_POLL_SECONDS, HotReloader, ScanService
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Persistent scanner: reads file paths on stdin, writes one JSON report per line"
+    )
+    parser.add_argument("--workers", type=int, default=4, help="Scans run concurrently")
+    parser.add_argument(
+        "--poll-seconds",
+        type=float,
+        default=DEFAULT_POLL_SECONDS,
+        help="How often to check for redeployed models and rules",
+    )
+    parser.add_argument("--metrics-port", type=int, default=None, help="Serve Prometheus metrics on /metrics")
+    parser.add_argument("--explain", action="store_true", help="Use LLM to explain findings")
+    parser.add_argument("--llm-only", action="store_true", help="Use LLM-only analysis (skip rules/ML)")
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    load_dotenv(Path(".env"))
+    reloader = HotReloader(poll_seconds=args.poll_seconds)
+    reloader.start()
+    if args.metrics_port is not None:
+        serve_metrics(args.metrics_port)
+    service = ScanService(reloader, explain=args.explain, llm_only=args.llm_only)
+    print(json.dumps({"status": "ready", "artifacts": reloader.status()}), flush=True)
+
+    write_lock = threading.Lock()
+
+    def _scan(line: str) -> None:
+        path = Path(line)
+        if not path.is_file():
+            report = {"input": line, "status": "error", "reason": "Input not found"}
+        else:
+            try:
+                report = service.scan(path)
+            except Exception as exc:
+                # Clients expect one line per path; a failed scan must still answer.
+                report = {"input": line, "status": "error", "reason": f"{type(exc).__name__}: {exc}"}
+        with write_lock:
+            print(json.dumps(report), flush=True)
+
+    with ThreadPoolExecutor(max_workers=max(1, args.workers)) as pool:
+        for line in sys.stdin:
+            if line.strip():
+                pool.submit(_scan, line.strip())
+    reloader.stop()
+
+
+if __name__ == "__main__":
+    main()
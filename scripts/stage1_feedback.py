@@ -0,0 +1,87 @@
+from __future__ import annotations
+
+import argparse
+from pathlib import Path
+
+from codeforesight.config import STAGE1_FEEDBACK_PATH
+from codeforesight.data.feedback_store import VERDICTS, record_feedback
+from codeforesight.stages.language_utils import detect_language
+from codeforesight.stages.stage1_model import predict_stage1
+from codeforesight.stages.stage1_online import load_history, rollback, update_from_feedback
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Triage feedback and online updates for Stage 1 models")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    rec = sub.add_parser("record", help="Record a verdict for the ML finding on a file")
+    rec.add_argument("--input", required=True, help="File the finding was reported on")
+    rec.add_argument("--verdict", required=True, choices=VERDICTS)
+    rec.add_argument("--label", help="Correct label, if neither SAFE nor the predicted one")
+
+    upd = sub.add_parser("update", help="Refit the deployed model on recorded feedback")
+    upd.add_argument("--language", choices=["c", "other"], default="c")
+
+    rb = sub.add_parser("rollback", help="Redeploy an earlier model version")
+    rb.add_argument("--language", choices=["c", "other"], default="c")
+    rb.add_argument("--version", type=int, help="Version to deploy (default: the previous one)")
+
+    hist = sub.add_parser("history", help="List model versions")
+    hist.add_argument("--language", choices=["c", "other"], default="c")
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+
+    if args.command == "record":
+        input_path = Path(args.input)
+        if not input_path.exists():
+            raise SystemExit(f"Input not found: {input_path}")
+        code = input_path.read_text(encoding="utf-8", errors="ignore")
+        language = detect_language(input_path, code)
+        prediction = predict_stage1(code, language)
+        if prediction is None:
+            raise SystemExit("Stage 1 model not found. Run scripts/train_stage1_model.py first.")
+        record = record_feedback(
+            STAGE1_FEEDBACK_PATH,
+            file=str(input_path),
+            language=language,
+            predicted=prediction.label,
+            verdict=args.verdict,
+            text=code,
+            label=args.label,
+        )
+        print(f"Recorded {record.verdict} for {record.file} ({record.predicted} -> {record.label}).")
+        return
+
+    try:
+        if args.command == "update":
+            result = update_from_feedback(args.language)
+            print(
+                f"Deployed {args.language} model v{result['version']} "
+                f"(from v{result['parent']}, {result['feedback_records']} feedback records, "
+                f"{result['seconds']}s)."
+            )
+            if result["holdout_rows"]:
+                print(
+                    f"Held-out accuracy: {result['holdout_accuracy']:.2%} "
+                    f"(base {result['base_accuracy']:.2%}, {result['holdout_rows']} rows)"
+                )
+        elif args.command == "rollback":
+            version = rollback(args.language, args.version)
+            print(f"Rolled back {args.language} model to v{version}.")
+        else:
+            history = load_history(args.language)
+            for entry in history["versions"]:
+                marker = "*" if entry["version"] == history["active"] else " "
+                print(
+                    f"{marker} v{entry['version']:<4} {entry['created']}  {entry.get('source', '')}"
+                    f"  feedback={entry.get('feedback_records', 0)}"
+                )
+    except (FileNotFoundError, ValueError) as exc:
+        raise SystemExit(str(exc)) from exc
+
+
+if __name__ == "__main__":
+    main()
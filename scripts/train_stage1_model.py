@@ -1,6 +1,6 @@
 from __future__ import annotations
 
-from pathlib import Path
+import argparse
 
 from codeforesight.config import (
     CURATED_PAIRS_DIR,
@@ -10,80 +10,45 @@ from codeforesight.config import (
     STAGE1_MODEL_C_PATH,
     STAGE1_MODEL_OTHER_PATH,
 )
-from codeforesight.data.curated_pairs import iter_curated_pairs
-from codeforesight.data.nvd_loader import iter_nvd_records
-from codeforesight.stages.language_utils import detect_language
-from codeforesight.stages.label_utils import map_cwe_to_group
-from codeforesight.stages.stage1_model import train_stage1_model
+from codeforesight.data.stage1_dataset import build_cve_to_cwe, build_stage1_samples
+from codeforesight.stages.stage1_model import VECTORIZER_MODES, load_stage1_config, train_stage1_model
 
 
-def _build_cve_to_cwe(nvd_dir: Path) -> dict[str, str]:
-    mapping: dict[str, str] = {}
-    for record in iter_nvd_records(nvd_dir):
-        if not record.cve_id:
-            continue
-        if record.cwe_ids:
-            mapping[record.cve_id] = record.cwe_ids[0]
-    return mapping
-
-
-def _read_text(path: Path) -> str:
-    return path.read_text(encoding="utf-8", errors="ignore")
-
-
-def _chunk_text(text: str, lines_per_chunk: int = 40, stride: int = 20, max_chunks: int = 20) -> list[str]:
-    lines = text.splitlines()
-    if not lines:
-        return []
-    if len(lines) <= lines_per_chunk:
-        return [text]
-    chunks: list[str] = []
-    for start in range(0, len(lines), stride):
-        end = start + lines_per_chunk
-        chunk = "\n".join(lines[start:end]).strip()
-        if chunk:
-            chunks.append(chunk)
-        if len(chunks) >= max_chunks:
-            break
-    return chunks
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Train Stage 1 classifiers")
+    parser.add_argument(
+        "--vectorizer",
+        choices=VECTORIZER_MODES,
+        default=None,
+        help=(
+            "tfidf keeps a pruned vocabulary; hashing is vocabulary-free and constant-memory "
+            "(default: the tuned configuration, else tfidf)"
+        ),
+    )
+    return parser.parse_args()
 
 
 def main() -> None:
-    cve_to_cwe = _build_cve_to_cwe(NVD_DIR)
-
-    texts_c: list[str] = []
-    labels_c: list[str] = []
-    texts_other: list[str] = []
-    labels_other: list[str] = []
-
-    for pair in iter_curated_pairs(CURATED_PAIRS_DIR):
-        cwe = cve_to_cwe.get(pair.cve_id, "")
-        label = map_cwe_to_group(cwe)
-        for file_path in pair.before_dir.rglob("*"):
-            if file_path.is_file():
-                language = detect_language(file_path)
-                for chunk in _chunk_text(_read_text(file_path)):
-                    if language == "c":
-                        texts_c.append(chunk)
-                        labels_c.append(label)
-                    else:
-                        texts_other.append(chunk)
-                        labels_other.append(label)
-        for file_path in pair.after_dir.rglob("*"):
-            if file_path.is_file():
-                language = detect_language(file_path)
-                for chunk in _chunk_text(_read_text(file_path)):
-                    if language == "c":
-                        texts_c.append(chunk)
-                        labels_c.append("SAFE")
-                    else:
-                        texts_other.append(chunk)
-                        labels_other.append("SAFE")
-
-    if texts_c:
-        train_stage1_model(texts_c, labels_c, STAGE1_MODEL_C_PATH, STAGE1_LABELS_C_PATH)
-    if texts_other:
-        train_stage1_model(texts_other, labels_other, STAGE1_MODEL_OTHER_PATH, STAGE1_LABELS_OTHER_PATH)
+    args = parse_args()
+    cve_to_cwe = build_cve_to_cwe(NVD_DIR)
+    samples = build_stage1_samples(CURATED_PAIRS_DIR, cve_to_cwe)
+
+    targets = [
+        ("c", "C/C++", STAGE1_MODEL_C_PATH, STAGE1_LABELS_C_PATH),
+        ("other", "Other", STAGE1_MODEL_OTHER_PATH, STAGE1_LABELS_OTHER_PATH),
+    ]
+    for language, name, model_path, labels_path in targets:
+        subset = samples[language]
+        if subset.texts:
+            train_stage1_model(
+                subset.texts,
+                subset.labels,
+                model_path,
+                labels_path,
+                vectorizer=args.vectorizer,
+                params=load_stage1_config(language),
+            )
+            print(f"{name} model: {model_path} ({model_path.stat().st_size / 1e6:.1f} MB)")
 
     def _print_dist(name: str, labels: list[str]) -> None:
         label_counts = {}
@@ -94,10 +59,9 @@ def main() -> None:
         for label, count in sorted(label_counts.items(), key=lambda x: x[1], reverse=True):
             print(f"- {label}: {count}")
 
-    if labels_c:
-        _print_dist("C/C++", labels_c)
-    if labels_other:
-        _print_dist("Other", labels_other)
+    for language, name, _, _ in targets:
+        if samples[language].labels:
+            _print_dist(name, samples[language].labels)
 
 
 if __name__ == "__main__":
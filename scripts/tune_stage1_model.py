@@ -0,0 +1,256 @@
+from __future__ import annotations
+
+import argparse
+import itertools
+import json
+import pickle
+import time
+from typing import Any, Dict, List, Tuple
+
+import numpy as np
+from joblib import Parallel, delayed
+from sklearn.feature_extraction.text import CountVectorizer, TfidfTransformer
+from sklearn.linear_model import LogisticRegression
+from sklearn.model_selection import GroupKFold
+
+from codeforesight.config import (
+    CURATED_PAIRS_DIR,
+    NVD_DIR,
+    STAGE1_CONFIG_PATH,
+    STAGE1_TUNING_LEADERBOARD_PATH,
+)
+from codeforesight.data.stage1_dataset import Stage1Samples, build_cve_to_cwe, build_stage1_samples
+from codeforesight.stages.stage1_features import HASH_N_FEATURES, StreamingIdfTransformer, hash_counts
+from codeforesight.stages.stage1_model import VECTORIZER_MODES
+
+
+def _int_list(value: str) -> List[int]:
+    return [int(v) for v in value.split(",") if v.strip()]
+
+
+def _float_list(value: str) -> List[float]:
+    return [float(v) for v in value.split(",") if v.strip()]
+
+
+def _ngram_list(value: str) -> List[Tuple[int, int]]:
+    ranges = []
+    for item in value.split(","):
+        low, _, high = item.strip().partition("-")
+        ranges.append((int(low), int(high or low)))
+    return ranges
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Grouped CV hyperparameter search for Stage 1")
+    parser.add_argument("--language", choices=["c", "other", "all"], default="all")
+    parser.add_argument("--vectorizer", choices=VECTORIZER_MODES, default="tfidf")
+    parser.add_argument("--folds", type=int, default=5, help="CVE-grouped folds")
+    parser.add_argument("--jobs", type=int, default=-1, help="Parallel workers (-1 = all cores)")
+    parser.add_argument("--max-features", type=_int_list, default=[5000, 20000, 50000])
+    parser.add_argument("--ngram", type=_ngram_list, default=[(1, 1), (1, 2), (1, 3)])
+    parser.add_argument("--C", dest="c_values", type=_float_list, default=[0.3, 1.0, 3.0])
+    parser.add_argument("--thresholds", type=_float_list, default=[0.4, 0.5, 0.6, 0.7])
+    parser.add_argument("--top", type=int, default=10, help="Leaderboard rows to print")
+    parser.add_argument("--dry-run", action="store_true", help="Do not write stage1_config.json")
+    return parser.parse_args()
+
+
+def _select_columns(
+    counts,
+    orders: np.ndarray,
+    rows: np.ndarray,
+    ngram_range: Tuple[int, int],
+    max_features: int,
+) -> np.ndarray:
+    """Same vocabulary TfidfVectorizer would keep, computed from the training rows only."""
+    allowed = np.flatnonzero((orders >= ngram_range[0]) & (orders <= ngram_range[1]))
+    freqs = np.asarray(counts[rows][:, allowed].sum(axis=0)).ravel()
+    present = allowed[freqs > 0]
+    freqs = freqs[freqs > 0]
+    if len(present) > max_features:
+        present = present[np.argsort(-freqs, kind="mergesort")[:max_features]]
+    return np.sort(present)
+
+
+def _candidate_matrices(features: Dict[str, Any], candidate: Dict[str, Any], train_idx, test_idx):
+    if candidate["vectorizer"] == "hashing":
+        counts = features["hashed"][tuple(candidate["ngram_range"])]
+        # IDF from the training rows only, as for TF-IDF below.
+        idf = StreamingIdfTransformer(n_features=HASH_N_FEATURES).fit(counts[train_idx])
+        return idf.transform(counts[train_idx]), idf.transform(counts[test_idx]), HASH_N_FEATURES
+    counts = features["counts"]
+    cols = _select_columns(
+        counts, features["orders"], train_idx, tuple(candidate["ngram_range"]), candidate["max_features"]
+    )
+    idf = TfidfTransformer().fit(counts[train_idx][:, cols])
+    return (
+        idf.transform(counts[train_idx][:, cols]),
+        idf.transform(counts[test_idx][:, cols]),
+        len(cols),
+    )
+
+
+def _run_fold(
+    features: Dict[str, Any],
+    labels: np.ndarray,
+    train_idx: np.ndarray,
+    test_idx: np.ndarray,
+    candidate: Dict[str, Any],
+    thresholds: List[float],
+) -> Dict[str, Any]:
+    x_train, x_test, n_features = _candidate_matrices(features, candidate, train_idx, test_idx)
+    clf = LogisticRegression(C=candidate["C"], max_iter=300, n_jobs=1, class_weight="balanced")
+    clf.fit(x_train, labels[train_idx])
+
+    started = time.perf_counter()
+    probs = clf.predict_proba(x_test)
+    per_chunk = (time.perf_counter() - started) / max(len(test_idx), 1)
+
+    best = probs.argmax(axis=1)
+    confidence = probs[np.arange(len(best)), best]
+    raw_pred = clf.classes_[best]
+    truth = labels[test_idx]
+    accuracy = {}
+    for threshold in thresholds:
+        pred = np.where((raw_pred != "SAFE") & (confidence < threshold), "SAFE", raw_pred)
+        accuracy[threshold] = float(np.mean(pred == truth))
+    return {
+        "accuracy": accuracy,
+        "latency": per_chunk,
+        "n_features": n_features,
+        "coef_bytes": int(clf.coef_.nbytes + clf.intercept_.nbytes),
+    }
+
+
+def _build_features(samples: Stage1Samples, args: argparse.Namespace) -> Dict[str, Any]:
+    """Featurize the corpus once; every candidate and fold slices these matrices."""
+    if args.vectorizer == "hashing":
+        hashed = {ngram_range: hash_counts(samples.texts, ngram_range=ngram_range) for ngram_range in args.ngram}
+        return {"hashed": hashed}
+    max_n = max(high for _, high in args.ngram)
+    counter = CountVectorizer(ngram_range=(1, max_n))
+    counts = counter.fit_transform(samples.texts).tocsr()
+    terms = counter.get_feature_names_out()
+    orders = np.fromiter((term.count(" ") + 1 for term in terms), dtype=np.int8, count=len(terms))
+    return {"counts": counts, "orders": orders, "terms": terms}
+
+
+def _vocabulary_bytes(features: Dict[str, Any], candidate: Dict[str, Any]) -> int:
+    if candidate["vectorizer"] == "hashing":
+        return 0
+    counts = features["counts"]
+    rows = np.arange(counts.shape[0])
+    cols = _select_columns(
+        counts, features["orders"], rows, tuple(candidate["ngram_range"]), candidate["max_features"]
+    )
+    terms = features["terms"]
+    vocabulary = {str(terms[col]): idx for idx, col in enumerate(cols)}
+    return len(pickle.dumps(vocabulary)) + len(cols) * 8
+
+
+def _tune_language(samples: Stage1Samples, args: argparse.Namespace) -> List[Dict[str, Any]]:
+    labels = np.asarray(samples.labels)
+    groups = np.asarray(samples.groups)
+    n_folds = min(args.folds, len(set(samples.groups)))
+    if n_folds < 2:
+        raise SystemExit("Need at least two CVEs per language for grouped cross-validation.")
+    folds = list(GroupKFold(n_splits=n_folds).split(samples.texts, labels, groups))
+    features = _build_features(samples, args)
+    # Threshold is applied after prediction, so it is scored without refitting.
+    max_features_grid = args.max_features if args.vectorizer == "tfidf" else [HASH_N_FEATURES]
+    candidates = [
+        {
+            "vectorizer": args.vectorizer,
+            "max_features": max_features,
+            "ngram_range": list(ngram_range),
+            "C": c_value,
+        }
+        for max_features, ngram_range, c_value in itertools.product(
+            max_features_grid, args.ngram, args.c_values
+        )
+    ]
+
+    # Workers only need the matrices; joblib memory-maps them instead of copying per task.
+    shared = {key: value for key, value in features.items() if key != "terms"}
+    tasks = [(cand_idx, fold) for cand_idx in range(len(candidates)) for fold in folds]
+    results = Parallel(n_jobs=args.jobs)(
+        delayed(_run_fold)(shared, labels, train_idx, test_idx, candidates[cand_idx], args.thresholds)
+        for cand_idx, (train_idx, test_idx) in tasks
+    )
+
+    per_candidate: Dict[int, List[Dict[str, Any]]] = {}
+    for (cand_idx, _), result in zip(tasks, results):
+        per_candidate.setdefault(cand_idx, []).append(result)
+
+    leaderboard: List[Dict[str, Any]] = []
+    for cand_idx, fold_results in per_candidate.items():
+        candidate = candidates[cand_idx]
+        coef_bytes = max(r["coef_bytes"] for r in fold_results)
+        model_bytes = coef_bytes + _vocabulary_bytes(features, candidate)
+        latency_ms = float(np.mean([r["latency"] for r in fold_results])) * 1000
+        for threshold in args.thresholds:
+            scores = [r["accuracy"][threshold] for r in fold_results]
+            leaderboard.append(
+                {
+                    **candidate,
+                    "threshold": threshold,
+                    "accuracy": round(float(np.mean(scores)), 4),
+                    "accuracy_std": round(float(np.std(scores)), 4),
+                    "model_bytes": int(model_bytes),
+                    "latency_ms_per_chunk": round(latency_ms, 4),
+                    "folds": len(fold_results),
+                }
+            )
+    leaderboard.sort(key=lambda r: (-r["accuracy"], r["model_bytes"], r["latency_ms_per_chunk"]))
+    return leaderboard
+
+
+def main() -> None:
+    args = parse_args()
+    cve_to_cwe = build_cve_to_cwe(NVD_DIR)
+    languages = ["c", "other"] if args.language == "all" else [args.language]
+    samples = build_stage1_samples(
+        CURATED_PAIRS_DIR, cve_to_cwe, language=None if args.language == "all" else args.language
+    )
+
+    leaderboards: Dict[str, List[Dict[str, Any]]] = {}
+    for language in languages:
+        if not samples[language].texts:
+            continue
+        started = time.perf_counter()
+        leaderboards[language] = _tune_language(samples[language], args)
+        elapsed = time.perf_counter() - started
+        print(f"[{language}] {len(samples[language].texts)} samples, search took {elapsed:.1f}s")
+        print("rank  acc     std     bytes       ms/chunk  params")
+        for rank, row in enumerate(leaderboards[language][: args.top], start=1):
+            params = (
+                f"{row['vectorizer']} max_features={row['max_features']} "
+                f"ngram={tuple(row['ngram_range'])} C={row['C']} threshold={row['threshold']}"
+            )
+            print(
+                f"{rank:<5} {row['accuracy']:.4f}  {row['accuracy_std']:.4f}  "
+                f"{row['model_bytes']:<10}  {row['latency_ms_per_chunk']:<8.4f}  {params}"
+            )
+    if not leaderboards:
+        raise SystemExit("No curated samples found. Run scripts/expand_curated_pairs.py first.")
+
+    STAGE1_TUNING_LEADERBOARD_PATH.parent.mkdir(parents=True, exist_ok=True)
+    STAGE1_TUNING_LEADERBOARD_PATH.write_text(json.dumps(leaderboards, indent=2), encoding="utf-8")
+    print(f"Wrote leaderboard to {STAGE1_TUNING_LEADERBOARD_PATH}")
+
+    if args.dry_run:
+        return
+    config: Dict[str, Any] = {}
+    if STAGE1_CONFIG_PATH.exists():
+        config = json.loads(STAGE1_CONFIG_PATH.read_text(encoding="utf-8"))
+    for language, rows in leaderboards.items():
+        best = rows[0]
+        config[language] = {
+            key: best[key] for key in ("vectorizer", "max_features", "ngram_range", "C", "threshold")
+        }
+    STAGE1_CONFIG_PATH.write_text(json.dumps(config, indent=2), encoding="utf-8")
+    print(f"Wrote best configuration to {STAGE1_CONFIG_PATH}; rerun scripts/train_stage1_model.py to apply.")
+
+
+if __name__ == "__main__":
+    main()
@@ -5,16 +5,52 @@ import json
 from pathlib import Path
 
 from codeforesight.config_env import load_dotenv
-from codeforesight.pipeline import run_pipeline
+from codeforesight.llm.context_windows import DEFAULT_CONTEXT_RADIUS, DEFAULT_CONTEXT_TOKENS
+from codeforesight.metrics import render_metrics
+from codeforesight.pipeline import scan_paths
+from codeforesight.progress import ProgressReporter
+from codeforesight.stages.language_utils import list_source_files
 
 
 def build_parser() -> argparse.ArgumentParser:
     parser = argparse.ArgumentParser(description="CodeForesight CLI")
-    parser.add_argument("--input", required=True, help="Path to source code file")
+    parser.add_argument("--input", required=True, help="Path to a source file, or a directory to scan")
+    parser.add_argument("--workers", type=int, default=4, help="Files analyzed in parallel when --input is a directory")
+    parser.add_argument(
+        "--processes",
+        action="store_true",
+        help="Use worker processes instead of threads; models are memory-mapped and shared",
+    )
     parser.add_argument("--out", help="Optional path to write JSON output")
+    parser.add_argument(
+        "--progress",
+        nargs="?",
+        const="text",
+        choices=["text", "json"],
+        help="Report progress on stderr: a status line (text) or one JSON event per line (json)",
+    )
+    parser.add_argument("--metrics-file", help="Optional path to write Prometheus-format metrics for the run")
     parser.add_argument("--pretty", action="store_true", help="Pretty-print JSON")
     parser.add_argument("--explain", action="store_true", help="Use LLM to explain findings")
-    parser.add_argument("--max-explain", type=int, default=3, help="Max findings to explain")
+    parser.add_argument("--max-explain", type=int, default=3, help="Max distinct issues to explain (repeated snippets count once)")
+    parser.add_argument(
+        "--context-radius",
+        type=int,
+        default=DEFAULT_CONTEXT_RADIUS,
+        help="Lines of code shown around each explained finding",
+    )
+    parser.add_argument(
+        "--context-tokens",
+        type=int,
+        default=DEFAULT_CONTEXT_TOKENS,
+        help="Token budget for the code sent with explanations",
+    )
+    parser.add_argument(
+        "--llm-deadline",
+        type=float,
+        default=None,
+        help="Seconds the LLM calls may take in total; the router switches to faster models as it nears",
+    )
     parser.add_argument("--llm-only", action="store_true", help="Use LLM-only analysis (skip rules/ML)")
     parser.add_argument("--stage1-only", action="store_true", help="Only return Stage 1 output")
     parser.add_argument("--stage2-only", action="store_true", help="Only return Stage 2 output")
@@ -41,15 +77,29 @@ def main() -> None:
     if sum(bool(x) for x in [stage1_only, stage2_only, stage3_only]) > 1:
         raise SystemExit("Use only one of --stage1/--stage2/--stage3 at a time.")
 
-    report = run_pipeline(
-        input_path,
+    paths = list_source_files(input_path)
+    if not paths:
+        raise SystemExit(f"No source files under: {input_path}")
+    progress = ProgressReporter(paths, json_events=args.progress == "json") if args.progress else None
+    if progress:
+        progress.start()
+    reports = scan_paths(
+        paths,
+        workers=args.workers,
+        processes=args.processes,
         explain=args.explain,
         max_explain=args.max_explain,
+        context_radius=args.context_radius,
+        context_tokens=args.context_tokens,
+        deadline_s=args.llm_deadline,
         llm_only=args.llm_only,
         stage1_only=stage1_only,
         stage2_only=stage2_only,
         stage3_only=stage3_only,
     )
+    if progress:
+        progress.stop()
+    report = reports[0] if input_path.is_file() else {"input": str(input_path), "files": reports}
     indent = 2 if args.pretty else None
     output = json.dumps(report, indent=indent)
 
@@ -57,6 +107,8 @@ def main() -> None:
         Path(args.out).write_text(output, encoding="utf-8")
     else:
         print(output)
+    if args.metrics_file:
+        Path(args.metrics_file).write_text(render_metrics(), encoding="utf-8")
 
 
 if __name__ == "__main__":
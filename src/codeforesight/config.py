@@ -12,11 +12,27 @@ NVD_DIR = DATA_DIR / "nvd_api"
 CWE_CSV = DATA_DIR / "cwe_catalog.csv"
 CURATED_PAIRS_DIR = DATA_DIR / "curated_pairs"
 PROCESSED_DIR = DATA_DIR / "processed"
+CVE_INDEX_PATH = PROCESSED_DIR / "cve_index.json"
+CVE_TEXT_INDEX_DIR = PROCESSED_DIR / "cve_text_index"
+MODELS_DIR = DATA_DIR / "models"
+LOCAL_LLM_MODEL_PATH = Path(
+    os.getenv("CODEFORESIGHT_LOCAL_MODEL", MODELS_DIR / "qwen2.5-coder-1.5b-instruct-q4_k_m.gguf")
+)
 
 STAGE1_MODEL_C_PATH = PROCESSED_DIR / "stage1_model_c.joblib"
 STAGE1_LABELS_C_PATH = PROCESSED_DIR / "stage1_labels_c.json"
 STAGE1_MODEL_OTHER_PATH = PROCESSED_DIR / "stage1_model_other.joblib"
 STAGE1_LABELS_OTHER_PATH = PROCESSED_DIR / "stage1_labels_other.json"
+STAGE1_COMPRESSED_MODEL_C_PATH = PROCESSED_DIR / "stage1_model_c.q8.joblib"
+STAGE1_COMPRESSED_MODEL_OTHER_PATH = PROCESSED_DIR / "stage1_model_other.q8.joblib"
+STAGE1_EVAL_CACHE_PATH = PROCESSED_DIR / "stage1_eval_cache.json"
+STAGE1_CONFIG_PATH = PROCESSED_DIR / "stage1_config.json"
+STAGE1_TUNING_LEADERBOARD_PATH = PROCESSED_DIR / "stage1_tuning_leaderboard.json"
+STAGE1_FEEDBACK_PATH = PROCESSED_DIR / "stage1_feedback.jsonl"
+STAGE1_VERSIONS_DIR = PROCESSED_DIR / "stage1_versions"
+STAGE1_CLONE_INDEX_PATH = PROCESSED_DIR / "stage1_clone_index.joblib"
+STAGE1_SIMILAR_INDEX_DIR = PROCESSED_DIR / "stage1_similar_index"
+STAGE1_RULES_PATH = PROCESSED_DIR / "stage1_rules.json"
 STAGE3_TEMPORAL_MODEL_PATH = PROCESSED_DIR / "stage3_temporal_model.joblib"
 STAGE3_TEMPORAL_META_PATH = PROCESSED_DIR / "stage3_temporal_meta.json"
 STAGE3_TIMELINE_MODEL_PATH = PROCESSED_DIR / "stage3_timeline_model.joblib"
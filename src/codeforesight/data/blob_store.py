@@ -0,0 +1,137 @@
+from __future__ import annotations
+
+import hashlib
+import io
+import os
+import tempfile
+from pathlib import Path
+from typing import BinaryIO, Iterator
+
+from codeforesight.data.zstd_io import (
+    ZSTD_SUFFIX,
+    DictionaryCache,
+    compress_bytes,
+    frame_dict_id,
+    open_binary,
+    zstd_available,
+)
+
+# Largest zstd frame header; enough to read the dictionary id before streaming.
+_FRAME_HEADER_MAX = 18
+# New blobs are compressed inline during ingest, so favour speed;
+# scripts/compress_corpus.py uses a high level for raw blobs offline.
+INGEST_LEVEL = 6
+
+
+class BlobStore:
+    """
+    Content-addressed file store: each distinct byte string is kept once under its SHA-256.
+    Blobs may be stored raw or zstd-compressed (`<id>.zst`); ids always hash the raw bytes.
+    """
+
+    def __init__(self, root: Path):
+        self.root = root
+        self.dictionaries = DictionaryCache(root / "_dicts")
+        self._active_dict_id: int | None = None
+        self._active_dict_read = False
+
+    @staticmethod
+    def blob_id(data: bytes) -> str:
+        return hashlib.sha256(data).hexdigest()
+
+    def path_for(self, blob_id: str) -> Path:
+        return self.root / blob_id[:2] / blob_id[2:]
+
+    def compressed_path_for(self, blob_id: str) -> Path:
+        path = self.path_for(blob_id)
+        return path.with_name(path.name + ZSTD_SUFFIX)
+
+    def stored_path(self, blob_id: str) -> Path:
+        compressed = self.compressed_path_for(blob_id)
+        return compressed if compressed.exists() else self.path_for(blob_id)
+
+    def exists(self, blob_id: str) -> bool:
+        return self.compressed_path_for(blob_id).exists() or self.path_for(blob_id).exists()
+
+    def stored_size(self, blob_id: str) -> int:
+        return self.stored_path(blob_id).stat().st_size
+
+    def active_dictionary_id(self) -> int | None:
+        """Dictionary new blobs are compressed with, set by scripts/compress_corpus.py. Read once per store."""
+        if not self._active_dict_read:
+            marker = self.dictionaries.root / "active"
+            if marker.exists():
+                self._active_dict_id = int(marker.read_text(encoding="utf-8").strip())
+            self._active_dict_read = True
+        return self._active_dict_id
+
+    def set_active_dictionary(self, dict_id: int) -> None:
+        self.dictionaries.root.mkdir(parents=True, exist_ok=True)
+        self._write_atomic(self.dictionaries.root / "active", str(dict_id).encode("ascii"))
+        self._active_dict_id = dict_id
+        self._active_dict_read = True
+
+    def _write_atomic(self, path: Path, data: bytes) -> None:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        # Write-then-rename so concurrent writers of the same blob never expose a partial file.
+        fd, tmp_name = tempfile.mkstemp(dir=path.parent, prefix=".tmp-")
+        try:
+            with os.fdopen(fd, "wb") as f:
+                f.write(data)
+            os.replace(tmp_name, path)
+        except BaseException:
+            Path(tmp_name).unlink(missing_ok=True)
+            raise
+
+    def put(self, data: bytes) -> str:
+        blob_id = self.blob_id(data)
+        if self.exists(blob_id):
+            return blob_id
+        dict_id = self.active_dictionary_id()
+        if dict_id is not None and zstd_available():
+            payload = compress_bytes(data, level=INGEST_LEVEL, dictionary=self.dictionaries.get(dict_id))
+            self._write_atomic(self.compressed_path_for(blob_id), payload)
+        else:
+            self._write_atomic(self.path_for(blob_id), data)
+        return blob_id
+
+    def compress(self, blob_id: str, level: int = 19) -> int:
+        """Recompress a raw blob in place with the active dictionary; returns bytes saved."""
+        raw_path = self.path_for(blob_id)
+        if not raw_path.exists():
+            return 0
+        dict_id = self.active_dictionary_id()
+        dictionary = self.dictionaries.get(dict_id) if dict_id is not None else None
+        data = raw_path.read_bytes()
+        payload = compress_bytes(data, level=level, dictionary=dictionary)
+        self._write_atomic(self.compressed_path_for(blob_id), payload)
+        raw_path.unlink()
+        return len(data) - len(payload)
+
+    def iter_ids(self, compressed: bool | None = None) -> Iterator[str]:
+        """Stored blob ids; `compressed` restricts to zstd or raw blobs."""
+        for shard in sorted(self.root.glob("[0-9a-f][0-9a-f]")):
+            for path in sorted(shard.iterdir()):
+                if path.name.startswith("."):
+                    continue
+                is_zst = path.name.endswith(ZSTD_SUFFIX)
+                if compressed is not None and is_zst != compressed:
+                    continue
+                yield shard.name + path.name.removesuffix(ZSTD_SUFFIX)
+
+    def open(self, blob_id: str) -> BinaryIO:
+        """Binary stream over a blob's raw bytes, decompressing on the fly."""
+        compressed = self.compressed_path_for(blob_id)
+        if not compressed.exists():
+            return self.path_for(blob_id).open("rb")
+        with compressed.open("rb") as f:
+            dict_id = frame_dict_id(f.read(_FRAME_HEADER_MAX))
+        return open_binary(compressed, dictionary=self.dictionaries.get(dict_id))
+
+    def get(self, blob_id: str) -> bytes:
+        with self.open(blob_id) as f:
+            return f.read()
+
+    def get_text(self, blob_id: str) -> str:
+        with io.TextIOWrapper(self.open(blob_id), encoding="utf-8", errors="ignore") as f:
+            return f.read()
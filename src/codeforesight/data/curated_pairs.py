@@ -1,8 +1,21 @@
 from __future__ import annotations
 
-from dataclasses import dataclass
+import json
+import sqlite3
+from dataclasses import dataclass, field
+from functools import lru_cache
 from pathlib import Path
-from typing import Iterator, List
+from typing import Dict, Iterable, Iterator, List, Tuple
+
+from codeforesight.data.blob_store import BlobStore
+from codeforesight.stages.label_utils import map_cwe_to_group
+from codeforesight.stages.language_utils import detect_language
+
+
+@lru_cache(maxsize=None)
+def _blob_store(root: Path) -> BlobStore:
+    # One store per root so zstd dictionaries are loaded once per process.
+    return BlobStore(root)
 
 
 @dataclass(frozen=True)
@@ -13,12 +26,141 @@ class CuratedPair:
     before_dir: Path
     after_dir: Path
     files: List[str]
+    # path -> blob id; empty for pairs still stored as before/after trees.
+    before_blobs: Dict[str, str] = field(default_factory=dict)
+    after_blobs: Dict[str, str] = field(default_factory=dict)
+    blob_root: Path | None = None
+    cwe_id: str = ""
+    cwe_group: str = ""
+
+    def list_files(self, side: str) -> List[str]:
+        blobs = self.before_blobs if side == "before" else self.after_blobs
+        if self.blob_root is not None:
+            return sorted(blobs)
+        root = self.before_dir if side == "before" else self.after_dir
+        if not root.exists():
+            return []
+        return sorted(p.relative_to(root).as_posix() for p in root.rglob("*") if p.is_file())
+
+    def read_text(self, side: str, rel_path: str) -> str:
+        if self.blob_root is not None:
+            blobs = self.before_blobs if side == "before" else self.after_blobs
+            return _blob_store(self.blob_root).get_text(blobs[rel_path])
+        root = self.before_dir if side == "before" else self.after_dir
+        return (root / rel_path).read_text(encoding="utf-8", errors="ignore")
+
+
+@dataclass(frozen=True)
+class ManifestFile:
+    path: str
+    before_blob: str
+    after_blob: str
+    before_size: int
+    after_size: int
+
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS pairs (
+    id INTEGER PRIMARY KEY,
+    cve_id TEXT NOT NULL,
+    repo_slug TEXT NOT NULL,
+    commit_url TEXT NOT NULL DEFAULT '',
+    cwe_id TEXT NOT NULL DEFAULT '',
+    cwe_group TEXT NOT NULL DEFAULT 'OTHER',
+    UNIQUE (cve_id, repo_slug)
+);
+CREATE TABLE IF NOT EXISTS files (
+    pair_id INTEGER NOT NULL REFERENCES pairs(id) ON DELETE CASCADE,
+    path TEXT NOT NULL,
+    language TEXT NOT NULL,
+    before_blob TEXT NOT NULL,
+    after_blob TEXT NOT NULL,
+    before_size INTEGER NOT NULL,
+    after_size INTEGER NOT NULL,
+    PRIMARY KEY (pair_id, path)
+) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS pairs_by_cwe_group ON pairs (cwe_group);
+CREATE INDEX IF NOT EXISTS files_by_language ON files (language, pair_id);
+"""
+
 
+def curated_blob_root(curated_dir: Path) -> Path:
+    return curated_dir / "_blobs"
 
-def iter_curated_pairs(curated_dir: Path) -> Iterator[CuratedPair]:
+
+def curated_index_path(curated_dir: Path) -> Path:
+    return curated_dir / "manifest.sqlite"
+
+
+def legacy_manifest_path(curated_dir: Path) -> Path:
+    """JSON manifest written before the indexed one; read once by build_curated_manifest.py."""
+    return curated_dir / "manifest.json"
+
+
+def open_index(index_path: Path) -> sqlite3.Connection:
+    index_path.parent.mkdir(parents=True, exist_ok=True)
+    conn = sqlite3.connect(str(index_path))
+    conn.execute("PRAGMA foreign_keys = ON")
+    conn.executescript(_SCHEMA)
+    return conn
+
+
+def indexed_pair_keys(curated_dir: Path) -> set[Tuple[str, str]]:
+    index_path = curated_index_path(curated_dir)
+    if not index_path.exists():
+        return set()
+    conn = open_index(index_path)
+    try:
+        return {(row[0], row[1]) for row in conn.execute("SELECT cve_id, repo_slug FROM pairs")}
+    finally:
+        conn.close()
+
+
+def add_pair(
+    conn: sqlite3.Connection,
+    cve_id: str,
+    repo_slug: str,
+    commit: str,
+    cwe_id: str,
+    files: Iterable[ManifestFile],
+) -> None:
+    """Insert or replace one pair and its files. The caller commits."""
+    conn.execute("DELETE FROM pairs WHERE cve_id = ? AND repo_slug = ?", (cve_id, repo_slug))
+    cur = conn.execute(
+        "INSERT INTO pairs (cve_id, repo_slug, commit_url, cwe_id, cwe_group) VALUES (?, ?, ?, ?, ?)",
+        (cve_id, repo_slug, commit, cwe_id, map_cwe_to_group(cwe_id)),
+    )
+    conn.executemany(
+        "INSERT INTO files (pair_id, path, language, before_blob, after_blob, before_size, after_size) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?)",
+        [
+            (
+                cur.lastrowid,
+                f.path,
+                detect_language(Path(f.path)),
+                f.before_blob,
+                f.after_blob,
+                f.before_size,
+                f.after_size,
+            )
+            for f in files
+        ],
+    )
+
+
+def load_legacy_manifest(curated_dir: Path) -> List[dict]:
+    path = legacy_manifest_path(curated_dir)
+    if not path.exists():
+        return []
+    return json.loads(path.read_text(encoding="utf-8")).get("pairs", [])
+
+
+def iter_tree_pairs(curated_dir: Path, skip: set[Tuple[str, str]] | None = None) -> Iterator[CuratedPair]:
+    """Pairs stored as per-CVE before/after directory trees with metadata.txt."""
+    skip = skip or set()
     for cve_dir in sorted(curated_dir.glob("CVE-*")):
         for pair_dir in sorted(cve_dir.iterdir()):
-            if not pair_dir.is_dir():
+            if not pair_dir.is_dir() or (cve_dir.name, pair_dir.name) in skip:
                 continue
             before_dir = pair_dir / "before"
             after_dir = pair_dir / "after"
@@ -40,3 +182,130 @@ def iter_curated_pairs(curated_dir: Path) -> Iterator[CuratedPair]:
                 after_dir=after_dir,
                 files=files,
             )
+
+
+@dataclass
+class IngestResult:
+    pairs: int = 0
+    files: int = 0
+    raw_bytes: int = 0
+    blob_ids: set[str] = field(default_factory=set)
+    # Tree directories now fully in the blob store; safe to prune after commit.
+    pair_dirs: List[Path] = field(default_factory=list)
+
+
+def ingest_unindexed_pairs(
+    conn: sqlite3.Connection,
+    curated_dir: Path,
+    store: BlobStore,
+    cve_to_cwe: Dict[str, str],
+) -> IngestResult:
+    """
+    Add legacy manifest.json pairs and before/after trees missing from the
+    index. Every writer runs this first, so once the index exists it covers
+    the whole corpus. The caller commits.
+    """
+    known = {(row[0], row[1]) for row in conn.execute("SELECT cve_id, repo_slug FROM pairs")}
+    result = IngestResult()
+
+    def _size(blob_id: str) -> int:
+        with store.open(blob_id) as f:
+            return sum(len(chunk) for chunk in iter(lambda: f.read(1 << 16), b""))
+
+    # Pairs from the earlier JSON manifest already live in the blob store.
+    for entry in load_legacy_manifest(curated_dir):
+        key = (entry["cve_id"], entry["repo_slug"])
+        if key in known:
+            continue
+        files = [
+            ManifestFile(f["path"], f["before"], f["after"], _size(f["before"]), _size(f["after"]))
+            for f in entry["files"]
+        ]
+        add_pair(conn, key[0], key[1], entry.get("commit", ""), cve_to_cwe.get(key[0], ""), files)
+        known.add(key)
+        result.pairs += 1
+
+    for pair in iter_tree_pairs(curated_dir, skip=known):
+        files = []
+        for rel_path in pair.list_files("before"):
+            after_path = pair.after_dir / rel_path
+            if not after_path.is_file():
+                continue
+            before = (pair.before_dir / rel_path).read_bytes()
+            after = after_path.read_bytes()
+            files.append(ManifestFile(rel_path, store.put(before), store.put(after), len(before), len(after)))
+            result.blob_ids.update((files[-1].before_blob, files[-1].after_blob))
+            result.raw_bytes += len(before) + len(after)
+            result.files += 2
+        add_pair(conn, pair.cve_id, pair.repo_slug, pair.commit, cve_to_cwe.get(pair.cve_id, ""), files)
+        result.pairs += 1
+        result.pair_dirs.append(pair.before_dir.parent)
+    return result
+
+
+def _iter_indexed_pairs(
+    curated_dir: Path,
+    cwe_group: str | None,
+    language: str | None,
+) -> Iterator[CuratedPair]:
+    conn = open_index(curated_index_path(curated_dir))
+    try:
+        rows = conn.execute(
+            "SELECT p.id, p.cve_id, p.repo_slug, p.commit_url, p.cwe_id, p.cwe_group, "
+            "f.path, f.before_blob, f.after_blob "
+            "FROM pairs p JOIN files f ON f.pair_id = p.id "
+            "WHERE (?1 IS NULL OR p.cwe_group = ?1) AND (?2 IS NULL OR f.language = ?2) "
+            "ORDER BY p.cve_id, p.repo_slug, f.path",
+            (cwe_group, language),
+        )
+        blob_root = curated_blob_root(curated_dir)
+        current: List[tuple] = []
+
+        def _build(group: List[tuple]) -> CuratedPair:
+            _, cve_id, repo_slug, commit, cwe_id, group_name = group[0][:6]
+            pair_dir = curated_dir / cve_id / repo_slug
+            return CuratedPair(
+                cve_id=cve_id,
+                repo_slug=repo_slug,
+                commit=commit,
+                before_dir=pair_dir / "before",
+                after_dir=pair_dir / "after",
+                files=[row[6] for row in group],
+                before_blobs={row[6]: row[7] for row in group},
+                after_blobs={row[6]: row[8] for row in group},
+                blob_root=blob_root,
+                cwe_id=cwe_id,
+                cwe_group=group_name,
+            )
+
+        for row in rows:
+            if current and row[0] != current[0][0]:
+                yield _build(current)
+                current = []
+            current.append(row)
+        if current:
+            yield _build(current)
+    finally:
+        conn.close()
+
+
+def iter_curated_pairs(
+    curated_dir: Path,
+    cwe_group: str | None = None,
+    language: str | None = None,
+) -> Iterator[CuratedPair]:
+    """
+    Read pairs from the indexed manifest (see scripts/build_curated_manifest.py),
+    optionally restricted to one CWE group and/or language. Without an index,
+    fall back to walking before/after trees.
+    """
+    if curated_index_path(curated_dir).exists():
+        yield from _iter_indexed_pairs(curated_dir, cwe_group, language)
+        return
+    if cwe_group is not None:
+        raise ValueError("Filtering by CWE group needs the curated index; run scripts/build_curated_manifest.py.")
+    for pair in iter_tree_pairs(curated_dir):
+        if language is not None:
+            if not any(detect_language(Path(p)) == language for p in pair.list_files("before")):
+                continue
+        yield pair
@@ -0,0 +1,163 @@
+from __future__ import annotations
+
+import json
+import re
+from collections import Counter
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Tuple
+
+import numpy as np
+
+from codeforesight.config import CVE_TEXT_INDEX_DIR
+from codeforesight.data.nvd_loader import CveRecord
+from codeforesight.data.versioned_dir import current_dir, publish_dir
+
+
+BM25_K1 = 1.2
+BM25_B = 0.75
+
+_TERM_RE = re.compile(r"[a-z0-9_]+(?:-[0-9]+)?")
+# Query filler as well as the most common description words.
+_STOPWORDS = {
+    "a", "an", "and", "any", "are", "as", "at", "be", "by", "cve", "cves", "for", "from", "in",
+    "is", "it", "mention", "mentioning", "mentions", "of", "on", "or", "that", "the", "this",
+    "to", "via", "which", "with",
+}
+
+
+@dataclass(frozen=True)
+class CveHit:
+    cve_id: str
+    score: float
+
+
+def tokenize_text(text: str) -> List[str]:
+    return [term for term in _TERM_RE.findall(text.lower()) if term not in _STOPWORDS]
+
+
+class CveTextIndex:
+    """
+    BM25 inverted index over CVE descriptions. Terms are sorted; postings for
+    term i are doc_ids[offsets[i]:offsets[i + 1]] with matching term counts.
+    """
+
+    def __init__(
+        self,
+        terms: List[str],
+        cve_ids: List[str],
+        offsets: np.ndarray,
+        doc_ids: np.ndarray,
+        term_freqs: np.ndarray,
+        doc_lengths: np.ndarray,
+    ):
+        self.terms = terms
+        self.cve_ids = cve_ids
+        self.offsets = offsets
+        self.doc_ids = doc_ids
+        self.term_freqs = term_freqs
+        self.doc_lengths = doc_lengths
+        self._term_ids = {term: idx for idx, term in enumerate(terms)}
+        self._avg_length = float(doc_lengths.mean()) if len(doc_lengths) else 0.0
+
+    @classmethod
+    def build(cls, records: Iterable[CveRecord]) -> "CveTextIndex":
+        postings: Dict[str, List[Tuple[int, int]]] = {}
+        cve_ids: List[str] = []
+        lengths: List[int] = []
+        for record in records:
+            if not record.cve_id:
+                continue
+            terms = tokenize_text(record.description) + [cwe.lower() for cwe in record.cwe_ids]
+            doc_id = len(cve_ids)
+            cve_ids.append(record.cve_id)
+            lengths.append(len(terms))
+            for term, count in Counter(terms).items():
+                postings.setdefault(term, []).append((doc_id, count))
+
+        terms_sorted = sorted(postings)
+        offsets = np.zeros(len(terms_sorted) + 1, dtype=np.int64)
+        offsets[1:] = np.cumsum([len(postings[term]) for term in terms_sorted])
+        doc_ids = np.empty(int(offsets[-1]), dtype=np.int32)
+        term_freqs = np.empty(int(offsets[-1]), dtype=np.uint16)
+        for idx, term in enumerate(terms_sorted):
+            entries = postings[term]
+            doc_ids[offsets[idx] : offsets[idx + 1]] = [doc for doc, _ in entries]
+            term_freqs[offsets[idx] : offsets[idx + 1]] = [min(count, 65535) for _, count in entries]
+        return cls(terms_sorted, cve_ids, offsets, doc_ids, term_freqs, np.asarray(lengths, dtype=np.int32))
+
+    def save(self, out_dir: Path) -> None:
+        arrays = {
+            "offsets": self.offsets,
+            "doc_ids": self.doc_ids,
+            "term_freqs": self.term_freqs,
+            "doc_lengths": self.doc_lengths,
+        }
+        # Published as one version, so readers never pair a vocabulary with another build's postings.
+        with publish_dir(out_dir) as version_dir:
+            for name, array in arrays.items():
+                np.save(version_dir / f"{name}.npy", array)
+            vocab = {"terms": self.terms, "cve_ids": self.cve_ids}
+            (version_dir / "vocab.json").write_text(json.dumps(vocab), encoding="utf-8")
+
+    @classmethod
+    def load(cls, index_dir: Path) -> "CveTextIndex":
+        index_dir = current_dir(index_dir)
+        vocab = json.loads((index_dir / "vocab.json").read_text(encoding="utf-8"))
+        return cls(
+            vocab["terms"],
+            vocab["cve_ids"],
+            np.load(index_dir / "offsets.npy"),
+            np.load(index_dir / "doc_ids.npy", mmap_mode="r"),
+            np.load(index_dir / "term_freqs.npy", mmap_mode="r"),
+            np.load(index_dir / "doc_lengths.npy"),
+        )
+
+    def search(self, query: str, k: int = 10, require_all: bool = False) -> List[CveHit]:
+        """BM25 top-k. With `require_all`, only CVEs containing every query term are returned."""
+        term_ids = [self._term_ids.get(term) for term in dict.fromkeys(tokenize_text(query))]
+        if not term_ids or (require_all and None in term_ids):
+            return []
+        n_docs = len(self.cve_ids)
+        scores = np.zeros(n_docs, dtype=np.float32)
+        matched = np.zeros(n_docs, dtype=np.int16)
+        for term_id in term_ids:
+            if term_id is None:
+                continue
+            start, end = self.offsets[term_id], self.offsets[term_id + 1]
+            docs = np.asarray(self.doc_ids[start:end])
+            tf = np.asarray(self.term_freqs[start:end], dtype=np.float32)
+            idf = np.log(1.0 + (n_docs - len(docs) + 0.5) / (len(docs) + 0.5))
+            norm = BM25_K1 * (1.0 - BM25_B + BM25_B * self.doc_lengths[docs] / self._avg_length)
+            scores[docs] += idf * tf * (BM25_K1 + 1.0) / (tf + norm)
+            matched[docs] += 1
+        if require_all:
+            scores[matched < len(term_ids)] = 0.0
+        candidates = np.flatnonzero(scores)
+        if not len(candidates):
+            return []
+        top = candidates[np.argsort(-scores[candidates], kind="stable")[:k]]
+        return [CveHit(self.cve_ids[i], round(float(scores[i]), 3)) for i in top]
+
+
+_INDEX_CACHE: Dict[Tuple[str, str, int], CveTextIndex] = {}
+
+
+def load_cve_text_index(index_dir: Path = CVE_TEXT_INDEX_DIR) -> CveTextIndex | None:
+    data_dir = current_dir(index_dir)
+    marker = data_dir / "vocab.json"
+    if not marker.exists():
+        return None
+    key = (str(index_dir), data_dir.name, marker.stat().st_mtime_ns)
+    if key not in _INDEX_CACHE:
+        for stale in [k for k in _INDEX_CACHE if k[0] == key[0]]:
+            del _INDEX_CACHE[stale]
+        _INDEX_CACHE[key] = CveTextIndex.load(data_dir)
+    return _INDEX_CACHE[key]
+
+
+def search_cves(query: str, k: int = 10, require_all: bool = False) -> List[CveHit]:
+    index = load_cve_text_index()
+    if index is None:
+        return []
+    return index.search(query, k=k, require_all=require_all)
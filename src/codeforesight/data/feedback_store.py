@@ -0,0 +1,87 @@
+from __future__ import annotations
+
+import hashlib
+import json
+from dataclasses import asdict, dataclass
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Dict, Iterator, List
+
+
+VERDICTS = ("false_positive", "true_positive")
+
+
+@dataclass(frozen=True)
+class FeedbackRecord:
+    finding_id: str
+    file: str
+    language: str
+    rule_id: str
+    predicted: str
+    verdict: str
+    label: str
+    text: str
+    recorded_at: str
+
+
+def finding_id(file: str, rule_id: str, predicted: str, text: str) -> str:
+    digest = hashlib.sha1(text.encode("utf-8", errors="ignore")).hexdigest()
+    return hashlib.sha1(f"{file}|{rule_id}|{predicted}|{digest}".encode("utf-8")).hexdigest()[:16]
+
+
+def record_feedback(
+    store_path: Path,
+    file: str,
+    language: str,
+    predicted: str,
+    verdict: str,
+    text: str,
+    rule_id: str = "S1-ML-MODEL",
+    label: str | None = None,
+) -> FeedbackRecord:
+    """
+    Append a triage verdict. A false positive teaches SAFE, a true positive
+    confirms the predicted label; `label` overrides either.
+    """
+    if verdict not in VERDICTS:
+        raise ValueError(f"Unknown verdict: {verdict}")
+    if label is None:
+        label = "SAFE" if verdict == "false_positive" else predicted
+    record = FeedbackRecord(
+        finding_id=finding_id(file, rule_id, predicted, text),
+        file=file,
+        language="c" if language == "c" else "other",
+        rule_id=rule_id,
+        predicted=predicted,
+        verdict=verdict,
+        label=label,
+        text=text,
+        recorded_at=datetime.now(timezone.utc).isoformat(timespec="seconds"),
+    )
+    store_path.parent.mkdir(parents=True, exist_ok=True)
+    with store_path.open("a", encoding="utf-8") as f:
+        f.write(json.dumps(asdict(record)) + "\n")
+    return record
+
+
+def iter_feedback(store_path: Path) -> Iterator[FeedbackRecord]:
+    if not store_path.exists():
+        return
+    with store_path.open("r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                yield FeedbackRecord(**json.loads(line))
+            except (json.JSONDecodeError, TypeError):
+                continue
+
+
+def load_feedback(store_path: Path, language: str) -> List[FeedbackRecord]:
+    """Latest verdict per finding for one language model."""
+    latest: Dict[str, FeedbackRecord] = {}
+    for record in iter_feedback(store_path):
+        if record.language == language:
+            latest[record.finding_id] = record
+    return list(latest.values())
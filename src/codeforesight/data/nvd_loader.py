@@ -1,9 +1,12 @@
 from __future__ import annotations
 
 import json
+import re
 from dataclasses import dataclass
 from pathlib import Path
-from typing import Iterable, Iterator, List
+from typing import Any, Iterable, Iterator, List, TextIO
+
+from codeforesight.data.zstd_io import ZSTD_SUFFIX, open_text
 
 
 @dataclass(frozen=True)
@@ -32,21 +35,81 @@ def _extract_cwe_ids(weaknesses: list[dict]) -> List[str]:
     return sorted(set(cwe_ids))
 
 
+def _nvd_feed_paths(nvd_dir: Path) -> List[Path]:
+    """Year feeds as `.json` or `.json.zst`; the compressed copy wins if both exist."""
+    feeds = {path.name: path for path in nvd_dir.glob("*.json")}
+    for path in nvd_dir.glob(f"*.json{ZSTD_SUFFIX}"):
+        feeds[path.name[: -len(ZSTD_SUFFIX)]] = path
+    return [feeds[name] for name in sorted(feeds)]
+
+
+_READ_SIZE = 1 << 16
+_VULNERABILITIES_RE = re.compile(r'"vulnerabilities"\s*:\s*\[')
+_ITEM_SEPARATORS = " \t\r\n,"
+
+
+def _iter_vulnerabilities(f: TextIO) -> Iterator[Any]:
+    """
+    Items of the feed's top-level "vulnerabilities" array, decoded one at a
+    time from the stream, so a year feed is never held in memory whole.
+    """
+    decoder = json.JSONDecoder()
+    buf = ""
+    eof = False
+
+    def _fill() -> None:
+        nonlocal buf, eof
+        chunk = f.read(_READ_SIZE)
+        eof = not chunk
+        buf += chunk
+
+    # NVD puts the array after a few scalar header fields.
+    match = _VULNERABILITIES_RE.search(buf)
+    while match is None and not eof:
+        _fill()
+        match = _VULNERABILITIES_RE.search(buf)
+    if match is None:
+        return
+    buf = buf[match.end() :]
+    while True:
+        pos = 0
+        while pos < len(buf) and buf[pos] in _ITEM_SEPARATORS:
+            pos += 1
+        if pos == len(buf):
+            if eof:
+                raise ValueError('Truncated NVD feed: "vulnerabilities" array is not closed')
+            buf = ""
+            _fill()
+            continue
+        if buf[pos] == "]":
+            return
+        try:
+            item, end = decoder.raw_decode(buf, pos)
+        except json.JSONDecodeError:
+            if eof:
+                raise
+            # The item runs past the buffer; read more and decode it again.
+            buf = buf[pos:]
+            _fill()
+            continue
+        yield item
+        buf = buf[end:]
+
+
 def iter_nvd_records(nvd_dir: Path) -> Iterator[CveRecord]:
-    for path in sorted(nvd_dir.glob("*.json")):
-        with path.open("r", encoding="utf-8") as f:
-            data = json.load(f)
-        for item in data.get("vulnerabilities", []) or []:
-            cve = item.get("cve", {})
-            cve_id = cve.get("id", "")
-            record = CveRecord(
-                cve_id=cve_id,
-                published=cve.get("published", ""),
-                description=_extract_description(cve.get("descriptions", [])),
-                cwe_ids=_extract_cwe_ids(cve.get("weaknesses", [])),
-                references=[ref.get("url", "") for ref in cve.get("references", []) or []],
-            )
-            yield record
+    for path in _nvd_feed_paths(nvd_dir):
+        with open_text(path) as f:
+            for item in _iter_vulnerabilities(f):
+                cve = item.get("cve", {})
+                cve_id = cve.get("id", "")
+                record = CveRecord(
+                    cve_id=cve_id,
+                    published=cve.get("published", ""),
+                    description=_extract_description(cve.get("descriptions", [])),
+                    cwe_ids=_extract_cwe_ids(cve.get("weaknesses", [])),
+                    references=[ref.get("url", "") for ref in cve.get("references", []) or []],
+                )
+                yield record
 
 
 def load_nvd_records(nvd_dir: Path) -> List[CveRecord]:
@@ -0,0 +1,52 @@
+from __future__ import annotations
+
+import os
+from contextlib import contextmanager
+from contextvars import ContextVar
+from pathlib import Path
+from typing import Any, Callable, Iterator, Mapping, TypeVar
+
+T = TypeVar("T")
+
+# Inherited by worker processes, so setting it in the parent covers the pool.
+SHARED_MODELS_ENV = "CODEFORESIGHT_SHARED_MODELS"
+
+
+def enable_shared_models() -> None:
+    os.environ[SHARED_MODELS_ENV] = "1"
+
+
+def shared_models_enabled() -> bool:
+    return os.getenv(SHARED_MODELS_ENV, "") not in {"", "0"}
+
+
+def load_model(path: Path) -> Any:
+    """
+    joblib.load; in shared mode the numpy arrays (weights, idf, signatures)
+    are memory-mapped read-only from the uncompressed pickle instead of
+    copied, so every process maps the same page-cache pages.
+    """
+    import joblib
+
+    return joblib.load(path, mmap_mode="r" if shared_models_enabled() else None)
+
+
+_PINNED: ContextVar[Mapping[str, Any] | None] = ContextVar("codeforesight_pinned_artifacts", default=None)
+
+
+@contextmanager
+def pinned_artifacts(artifacts: Mapping[str, Any]) -> Iterator[None]:
+    """Inside the block, `resolve` serves these loaded artifacts instead of reading disk."""
+    token = _PINNED.set(artifacts)
+    try:
+        yield
+    finally:
+        _PINNED.reset(token)
+
+
+def resolve(name: str, load: Callable[[], T]) -> T:
+    """The pinned artifact `name` when a scan has one, else `load()`."""
+    artifacts = _PINNED.get()
+    if artifacts is not None and name in artifacts:
+        return artifacts[name]
+    return load()
@@ -0,0 +1,72 @@
+from __future__ import annotations
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List
+
+from codeforesight.data.curated_pairs import iter_curated_pairs
+from codeforesight.data.nvd_loader import iter_nvd_records
+from codeforesight.stages.label_utils import map_cwe_to_group
+from codeforesight.stages.language_utils import detect_language
+
+
+@dataclass
+class Stage1Samples:
+    texts: List[str] = field(default_factory=list)
+    labels: List[str] = field(default_factory=list)
+    groups: List[str] = field(default_factory=list)
+
+    def add(self, text: str, label: str, group: str) -> None:
+        self.texts.append(text)
+        self.labels.append(label)
+        self.groups.append(group)
+
+
+def build_cve_to_cwe(nvd_dir: Path) -> Dict[str, str]:
+    mapping: Dict[str, str] = {}
+    for record in iter_nvd_records(nvd_dir):
+        if not record.cve_id:
+            continue
+        if record.cwe_ids:
+            mapping[record.cve_id] = record.cwe_ids[0]
+    return mapping
+
+
+def chunk_text(text: str, lines_per_chunk: int = 40, stride: int = 20, max_chunks: int = 20) -> List[str]:
+    lines = text.splitlines()
+    if not lines:
+        return []
+    if len(lines) <= lines_per_chunk:
+        return [text]
+    chunks: List[str] = []
+    for start in range(0, len(lines), stride):
+        end = start + lines_per_chunk
+        chunk = "\n".join(lines[start:end]).strip()
+        if chunk:
+            chunks.append(chunk)
+        if len(chunks) >= max_chunks:
+            break
+    return chunks
+
+
+def build_stage1_samples(
+    curated_dir: Path,
+    cve_to_cwe: Dict[str, str],
+    language: str | None = None,
+) -> Dict[str, Stage1Samples]:
+    """
+    Chunk every curated file into per-language samples. `before` files carry
+    the CVE's CWE group, `after` files are SAFE; groups hold the CVE id so
+    cross-validation can keep a fix's two sides in the same fold.
+    """
+    samples = {"c": Stage1Samples(), "other": Stage1Samples()}
+    for pair in iter_curated_pairs(curated_dir, language=language):
+        label = map_cwe_to_group(cve_to_cwe.get(pair.cve_id, "") or pair.cwe_id)
+        for side, file_label in (("before", label), ("after", "SAFE")):
+            for rel_path in pair.list_files(side):
+                file_language = detect_language(Path(rel_path))
+                if language is not None and file_language != language:
+                    continue
+                for chunk in chunk_text(pair.read_text(side, rel_path)):
+                    samples[file_language].add(chunk, file_label, pair.cve_id)
+    return samples
@@ -0,0 +1,50 @@
+from __future__ import annotations
+
+import os
+import shutil
+import time
+from contextlib import contextmanager
+from pathlib import Path
+from typing import Iterator
+
+CURRENT_FILE = "CURRENT"
+# The previous version stays until the next publish, for readers still loading it.
+KEEP_VERSIONS = 2
+
+
+def current_dir(index_dir: Path) -> Path:
+    """Directory of the published version, or `index_dir` itself for indexes written before versioning."""
+    try:
+        version = (index_dir / CURRENT_FILE).read_text(encoding="utf-8").strip()
+    except FileNotFoundError:
+        return index_dir
+    return index_dir / version
+
+
+def _versions(index_dir: Path) -> list[Path]:
+    found = [p for p in index_dir.iterdir() if p.is_dir() and p.name[:1] == "v" and p.name[1:].isdigit()]
+    return sorted(found, key=lambda p: int(p.name[1:]))
+
+
+@contextmanager
+def publish_dir(index_dir: Path) -> Iterator[Path]:
+    """
+    Yields an empty version directory to write a multi-file index into. On
+    success, CURRENT is pointed at it with a single rename, so readers see
+    either the old set of files or the new one, never a mix.
+    """
+    index_dir.mkdir(parents=True, exist_ok=True)
+    version = f"v{time.time_ns()}"
+    staging = index_dir / version
+    staging.mkdir()
+    try:
+        yield staging
+    except BaseException:
+        shutil.rmtree(staging, ignore_errors=True)
+        raise
+    tmp_path = index_dir / f".{CURRENT_FILE}.tmp"
+    tmp_path.write_text(version, encoding="utf-8")
+    os.replace(tmp_path, index_dir / CURRENT_FILE)
+    for old in _versions(index_dir)[:-KEEP_VERSIONS]:
+        # Mapped arrays stay valid on POSIX; elsewhere a busy version is removed next time.
+        shutil.rmtree(old, ignore_errors=True)
@@ -0,0 +1,103 @@
+from __future__ import annotations
+
+import io
+from pathlib import Path
+from typing import BinaryIO, Dict, TextIO
+
+try:
+    import zstandard
+except ImportError:  # Optional: only needed once the corpus has been compressed.
+    zstandard = None
+
+
+ZSTD_SUFFIX = ".zst"
+
+
+def zstd_available() -> bool:
+    return zstandard is not None
+
+
+def _require_zstd() -> None:
+    if zstandard is None:
+        raise RuntimeError("Reading or writing .zst corpus files needs the 'zstandard' package.")
+
+
+def is_compressed(path: Path) -> bool:
+    return path.suffix == ZSTD_SUFFIX
+
+
+def compressed_path(path: Path) -> Path:
+    return path.with_name(path.name + ZSTD_SUFFIX)
+
+
+def open_binary(path: Path, dictionary: "zstandard.ZstdCompressionDict | None" = None) -> BinaryIO:
+    """Open a file for reading, decompressing `.zst` files as a stream."""
+    if not is_compressed(path):
+        return path.open("rb")
+    _require_zstd()
+    dctx = zstandard.ZstdDecompressor(dict_data=dictionary)
+    return dctx.stream_reader(path.open("rb"), closefd=True)
+
+
+def open_text(path: Path, encoding: str = "utf-8", errors: str = "strict") -> TextIO:
+    return io.TextIOWrapper(open_binary(path), encoding=encoding, errors=errors)
+
+
+def compress_bytes(
+    data: bytes,
+    level: int = 19,
+    dictionary: "zstandard.ZstdCompressionDict | None" = None,
+) -> bytes:
+    _require_zstd()
+    return zstandard.ZstdCompressor(level=level, dict_data=dictionary, write_checksum=True).compress(data)
+
+
+def compress_file(src: Path, dst: Path, level: int = 19) -> None:
+    """Stream-compress `src` into `dst` without holding the file in memory."""
+    _require_zstd()
+    cctx = zstandard.ZstdCompressor(level=level, write_checksum=True, threads=-1)
+    with src.open("rb") as fin, dst.open("wb") as fout:
+        cctx.copy_stream(fin, fout)
+
+
+def frame_dict_id(data: bytes) -> int:
+    _require_zstd()
+    return zstandard.get_frame_parameters(data).dict_id
+
+
+def train_dictionary(
+    samples: list[bytes],
+    dict_size: int = 112 * 1024,
+) -> "zstandard.ZstdCompressionDict | None":
+    """Train a dictionary for many small, similar inputs; None if there are too few samples."""
+    _require_zstd()
+    try:
+        return zstandard.train_dictionary(dict_size, samples)
+    except zstandard.ZstdError:
+        return None
+
+
+class DictionaryCache:
+    """Dictionaries loaded by id; frames record which one they were compressed with."""
+
+    def __init__(self, root: Path):
+        self.root = root
+        self._loaded: Dict[int, "zstandard.ZstdCompressionDict"] = {}
+
+    def path_for(self, dict_id: int) -> Path:
+        return self.root / f"{dict_id}.dict"
+
+    def get(self, dict_id: int) -> "zstandard.ZstdCompressionDict | None":
+        if dict_id == 0:
+            return None
+        if dict_id not in self._loaded:
+            _require_zstd()
+            self._loaded[dict_id] = zstandard.ZstdCompressionDict(self.path_for(dict_id).read_bytes())
+        return self._loaded[dict_id]
+
+    def save(self, dictionary: "zstandard.ZstdCompressionDict") -> int:
+        self.root.mkdir(parents=True, exist_ok=True)
+        dict_id = dictionary.dict_id()
+        self.path_for(dict_id).write_bytes(dictionary.as_bytes())
+        self._loaded[dict_id] = dictionary
+        return dict_id
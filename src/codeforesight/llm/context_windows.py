@@ -0,0 +1,73 @@
+from __future__ import annotations
+
+from typing import Iterable, List, Tuple
+
+from codeforesight.llm.prompt_compression import CompressedCode, estimate_tokens
+
+DEFAULT_CONTEXT_RADIUS = 12
+DEFAULT_CONTEXT_TOKENS = 1500
+_GAP_MARKER = "..."
+
+
+def merge_windows(lines: Iterable[int], radius: int, total_lines: int) -> List[Tuple[int, int, int]]:
+    """
+    Windows (start, end, anchor) around 1-based `lines`, merged where they overlap
+    or touch. The anchor is the earliest of `lines` in the window, and windows
+    are ordered by it, so the highest-priority finding's code is kept first
+    when the budget runs out.
+    """
+    # (start, end, priority, anchor); priority is the line's position in `lines`.
+    intervals = sorted(
+        (max(1, line - radius), min(total_lines, line + radius), priority, line)
+        for priority, line in enumerate(lines)
+        if 0 < line <= total_lines
+    )
+    merged: List[List[int]] = []
+    for start, end, priority, line in intervals:
+        if merged and start <= merged[-1][1] + 1:
+            window = merged[-1]
+            window[1] = max(window[1], end)
+            if priority < window[2]:
+                window[2], window[3] = priority, line
+        else:
+            merged.append([start, end, priority, line])
+    merged.sort(key=lambda window: window[2])
+    return [(start, end, anchor) for start, end, _, anchor in merged]
+
+
+def build_finding_context(
+    code: CompressedCode,
+    lines: Iterable[int],
+    radius: int = DEFAULT_CONTEXT_RADIUS,
+    token_budget: int = DEFAULT_CONTEXT_TOKENS,
+) -> str:
+    """
+    Numbered source around each finding line, in merged windows capped to
+    `token_budget`. Without usable line numbers, the file head is used instead.
+    Windows are measured in original lines; dropped lines don't widen them.
+    """
+    total_lines = code.line_map[-1] if code.line_map else 0
+    windows = merge_windows(lines, radius, total_lines)
+    if not windows:
+        windows = [(1, min(total_lines, 2 * radius + 1), 1)] if total_lines else []
+
+    parts: List[str] = []
+    used = 0
+    for start, end, anchor in windows:
+        block = code.render(start, end)
+        cost = estimate_tokens(block) + 1
+        while used + cost > token_budget and end > start:
+            # Shrink toward the anchor line, dropping the farther side first.
+            if end - anchor >= anchor - start:
+                end -= 1
+            else:
+                start += 1
+            block = code.render(start, end)
+            cost = estimate_tokens(block) + 1
+        if not block or used + cost > token_budget:
+            continue
+        parts.append(block)
+        used += cost
+    # Present windows in file order so the model reads the code top to bottom.
+    parts.sort(key=lambda block: int(block.split("|", 1)[0]))
+    return f"\n{_GAP_MARKER}\n".join(parts)
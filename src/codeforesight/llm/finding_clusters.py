@@ -0,0 +1,68 @@
+from __future__ import annotations
+
+import re
+from dataclasses import dataclass, field
+from typing import Any, Dict, List
+
+_STRING_RE = re.compile(r"\"(?:\\.|[^\"\\])*\"|'(?:\\.|[^'\\])*'")
+_NUMBER_RE = re.compile(r"\b\d+(?:\.\d+)?\b")
+_SPACE_RE = re.compile(r"\s+")
+
+
+@dataclass
+class FindingCluster:
+    key: str
+    rule_ids: List[str] = field(default_factory=list)
+    cwe_ids: List[str] = field(default_factory=list)
+    members: List[int] = field(default_factory=list)
+
+    def representative(self, findings: List[Dict[str, Any]]) -> Dict[str, Any]:
+        """One finding per cluster, carrying every rule and CWE that fired on it."""
+        first = findings[self.members[0]]
+        return {
+            "rule_ids": self.rule_ids,
+            "cwe_ids": self.cwe_ids,
+            "name": first.get("name", ""),
+            "severity": first.get("severity", ""),
+            "snippet": first.get("snippet", ""),
+            "occurrences": len(self.members),
+        }
+
+
+def normalize_snippet(snippet: str) -> str:
+    """Literal values and whitespace don't change what a line does."""
+    snippet = _STRING_RE.sub('"S"', snippet)
+    snippet = _NUMBER_RE.sub("N", snippet)
+    return _SPACE_RE.sub(" ", snippet).strip()
+
+
+def cluster_key(finding: Dict[str, Any]) -> str:
+    snippet = normalize_snippet(finding.get("snippet", ""))
+    if not finding.get("line"):
+        # File-level findings (line 0, e.g. the ML model) carry metadata, not code.
+        return f"{finding.get('rule_id', '')}|{finding.get('cwe_id', '')}"
+    return snippet
+
+
+def cluster_findings(findings: List[Dict[str, Any]]) -> List[FindingCluster]:
+    """Group findings sharing a normalized snippet; clusters keep first-seen order."""
+    clusters: Dict[str, FindingCluster] = {}
+    for idx, finding in enumerate(findings):
+        key = cluster_key(finding)
+        cluster = clusters.setdefault(key, FindingCluster(key=key))
+        cluster.members.append(idx)
+        for attr, values in (("rule_id", cluster.rule_ids), ("cwe_id", cluster.cwe_ids)):
+            value = finding.get(attr, "")
+            if value and value not in values:
+                values.append(value)
+    return list(clusters.values())
+
+
+def fan_out(findings: List[Dict[str, Any]], clusters: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
+    """Copy each cluster's explanation onto its member findings."""
+    out = [dict(finding) for finding in findings]
+    for cluster in clusters:
+        for idx in cluster.get("members", []):
+            if 0 <= idx < len(out) and cluster.get("explanation"):
+                out[idx]["explanation"] = cluster["explanation"]
+    return out
@@ -2,12 +2,28 @@ from __future__ import annotations
 
 import json
 import os
+import re
+import threading
+import time
 import urllib.error
 import urllib.request
-from typing import Any, Dict, List
+from collections import OrderedDict
+from contextlib import nullcontext
+from typing import Any, Dict, List, Tuple
+
+from codeforesight.llm.finding_clusters import cluster_findings
+from codeforesight.llm.local_backend import get_local_backend, llm_backend, local_model_name
+from codeforesight.llm.prompt_compression import estimate_tokens
+from codeforesight.llm.rate_limit import get_rate_limiter
+from codeforesight.llm.router import LARGE_MODEL, MODELS, ROUTER, RouteDecision, remaining_ms
+from codeforesight.llm.single_flight import SingleFlight, prompt_key
+from codeforesight.llm.usage import LlmCall, record_call
+from codeforesight.metrics import CACHE_REQUESTS
 
 
 GROQ_ENDPOINT = "https://api.groq.com/openai/v1/chat/completions"
+# Parallel scans of duplicated files send identical prompts at the same moment.
+_IN_FLIGHT: SingleFlight[Tuple[Dict[str, Any], float]] = SingleFlight()
 
 
 def _post_json(url: str, payload: Dict[str, Any], api_key: str) -> Dict[str, Any]:
@@ -30,61 +46,237 @@ def _post_json(url: str, payload: Dict[str, Any], api_key: str) -> Dict[str, Any
         raise RuntimeError(f"Groq API error {err.code}: {details}") from err
 
 
+def _api_key() -> str:
+    """The Groq key; the local backend needs none, so it gets a placeholder."""
+    if llm_backend() == "local":
+        return "local"
+    return os.getenv("GROQ_API_KEY", "")
+
+
+def _prompt_tokens(messages: List[Dict[str, Any]]) -> int:
+    return sum(estimate_tokens(m.get("content", "")) for m in messages)
+
+
+def _route(model: str | None, stage: str, messages: List[Dict[str, Any]]) -> RouteDecision:
+    """Explicit models are pinned; otherwise the router picks from stage, size and health."""
+    if model:
+        fallback = next((name for name in MODELS if name != model), LARGE_MODEL.name)
+        return RouteDecision(model=model, fallback=fallback, reason="pinned")
+    return ROUTER.route(stage, _prompt_tokens(messages), remaining_ms())
+
+
+def _send(payload: Dict[str, Any], api_key: str, stage: str, route: str) -> Tuple[Dict[str, Any], float]:
+    """POST through the rate limiter (or run locally); returns the response and its latency in ms."""
+    local = api_key == "local"
+    prompt_estimate = _prompt_tokens(payload.get("messages", []))
+    # The API's rate limits don't apply to the local model.
+    slot = nullcontext() if local else get_rate_limiter().slot(prompt_estimate + int(payload.get("max_tokens", 0)))
+    # Latency is measured after the rate limiter admits the call.
+    with slot:
+        start = time.perf_counter()
+        try:
+            if local:
+                response = get_local_backend().complete(payload)
+            else:
+                response = _post_json(GROQ_ENDPOINT, payload, api_key)
+        except RuntimeError:
+            if not local:
+                ROUTER.observe(payload.get("model", ""), (time.perf_counter() - start) * 1000, ok=False)
+            record_call(
+                LlmCall(
+                    stage=stage,
+                    model=local_model_name() if local else payload.get("model", ""),
+                    status="error",
+                    prompt_tokens=prompt_estimate,
+                    completion_tokens=0,
+                    latency_ms=round((time.perf_counter() - start) * 1000, 1),
+                    estimated=True,
+                    route=route,
+                )
+            )
+            raise
+    latency_ms = round((time.perf_counter() - start) * 1000, 1)
+    # Router stats describe the Groq models; the local model's timings would skew them.
+    if not local:
+        ROUTER.observe(payload.get("model", ""), latency_ms, ok=True)
+    return response, latency_ms
+
+
+def _chat(payload: Dict[str, Any], api_key: str, stage: str, route: str = "") -> str:
+    """
+    One chat completion; records tokens, latency and the routing reason for the report.
+    Identical payloads already in flight share that call instead of making another.
+    """
+    waited = time.perf_counter()
+    (response, latency_ms), shared = _IN_FLIGHT.do(
+        prompt_key(payload), lambda: _send(payload, api_key, stage, route)
+    )
+    content = response.get("choices", [{}])[0].get("message", {}).get("content", "") or ""
+    if shared:
+        # No tokens spent here; the caller that made the request already counted them.
+        record_call(
+            LlmCall(
+                stage=stage,
+                model=response.get("model", payload.get("model", "")),
+                status="shared",
+                prompt_tokens=0,
+                completion_tokens=0,
+                latency_ms=round((time.perf_counter() - waited) * 1000, 1),
+                estimated=False,
+                route=route,
+            )
+        )
+        return content
+    usage = response.get("usage") or {}
+    prompt_estimate = _prompt_tokens(payload.get("messages", []))
+    record_call(
+        LlmCall(
+            stage=stage,
+            model=response.get("model", payload.get("model", "")),
+            status="ok",
+            prompt_tokens=int(usage.get("prompt_tokens", prompt_estimate)),
+            completion_tokens=int(usage.get("completion_tokens", estimate_tokens(content))),
+            latency_ms=latency_ms,
+            estimated="prompt_tokens" not in usage,
+            route=route,
+        )
+    )
+    return content
+
+
+_NUMBERED_RE = re.compile(r"^\s*\[(\d+)\]\s*", re.MULTILINE)
+# Explanations by (model, cluster key); identical snippets in later files reuse them.
+# Least recently used entries are evicted past the cap, so a long-lived service stays bounded.
+EXPLANATION_CACHE_SIZE = 2048
+_EXPLANATION_CACHE: "OrderedDict[Tuple[str, str], str]" = OrderedDict()
+_EXPLANATION_CACHE_LOCK = threading.Lock()
+
+
+def _cached_explanation(key: Tuple[str, str]) -> str | None:
+    with _EXPLANATION_CACHE_LOCK:
+        text = _EXPLANATION_CACHE.get(key)
+        if text is not None:
+            _EXPLANATION_CACHE.move_to_end(key)
+    CACHE_REQUESTS.inc(cache="explanation", result="hit" if text else "miss")
+    return text
+
+
+def _cache_explanation(key: Tuple[str, str], text: str) -> None:
+    with _EXPLANATION_CACHE_LOCK:
+        _EXPLANATION_CACHE[key] = text
+        _EXPLANATION_CACHE.move_to_end(key)
+        while len(_EXPLANATION_CACHE) > EXPLANATION_CACHE_SIZE:
+            _EXPLANATION_CACHE.popitem(last=False)
+
+
+def _split_numbered(content: str, count: int) -> Dict[int, str]:
+    """Map "[n] text" paragraphs back to 1-based cluster numbers."""
+    parts = _NUMBERED_RE.split(content)
+    numbered: Dict[int, str] = {}
+    for number, text in zip(parts[1::2], parts[2::2]):
+        if 1 <= int(number) <= count and text.strip():
+            numbered[int(number)] = text.strip()
+    return numbered
+
+
 def explain_findings(
     findings: List[Dict[str, Any]],
     code_snippet: str,
-    model: str = "openai/gpt-oss-120b",
+    model: str | None = None,
     max_findings: int = 3,
 ) -> Dict[str, Any]:
-    api_key = os.getenv("GROQ_API_KEY", "")
+    """
+    Explain up to `max_findings` distinct issues. Findings are clustered by
+    normalized snippet first, so repeated lines and lines tripping several
+    rules cost one explanation; `clusters` lists member indices for fan-out.
+    """
+    clusters = cluster_findings(findings)[:max_findings]
+    representatives = [cluster.representative(findings) for cluster in clusters]
+    result_clusters = [
+        {"rule_ids": c.rule_ids, "cwe_ids": c.cwe_ids, "members": c.members, "explanation": ""}
+        for c in clusters
+    ]
+
+    def _result(status: str, **extra: Any) -> Dict[str, Any]:
+        return {
+            "status": status,
+            **extra,
+            "explanations": [c["explanation"] for c in result_clusters if c["explanation"]],
+            "clusters": result_clusters,
+        }
+
+    api_key = _api_key()
     if not api_key:
         return {
             "status": "skipped",
             "reason": "GROQ_API_KEY not set",
             "explanations": [],
+            "clusters": [],
         }
 
-    trimmed_findings = findings[:max_findings]
+    cache_model = model or "routed"
+    pending = []
+    for idx, cluster in enumerate(clusters):
+        cached = _cached_explanation((cache_model, cluster.key))
+        if cached:
+            result_clusters[idx]["explanation"] = cached
+        else:
+            pending.append(idx)
+    if not pending:
+        return _result("ok", model=cache_model, cached=True)
+
+    numbered = [{"id": n + 1, **representatives[idx]} for n, idx in enumerate(pending)]
     prompt = {
         "role": "user",
         "content": (
-            "You are a security assistant. Explain each finding with:\n"
+            "You are a security assistant. Explain each numbered issue with:\n"
             "1) Why it is risky\n"
             "2) How to fix it\n"
-            "Keep it short (2-3 sentences each).\n\n"
-            f"Findings: {json.dumps(trimmed_findings)}\n\n"
+            "Keep it short (2-3 sentences each). Start each answer on a new line "
+            "with its id in brackets, e.g. [1].\n\n"
+            f"Issues: {json.dumps(numbered)}\n\n"
             f"Code snippet:\n{code_snippet}\n"
         ),
     }
 
+    decision = _route(model, "stage1_explain", [prompt])
     payload = {
-        "model": model,
+        "model": decision.model,
         "messages": [prompt],
         "temperature": 0.2,
-        "max_tokens": 400,
+        "max_tokens": 150 * len(pending),
     }
 
     try:
-        response = _post_json(GROQ_ENDPOINT, payload, api_key)
-        content = response.get("choices", [{}])[0].get("message", {}).get("content", "")
-        return {
-            "status": "ok",
-            "model": model,
-            "explanations": [content.strip()] if content else [],
-        }
+        content = _chat(payload, api_key, stage="stage1_explain", route=decision.reason)
     except RuntimeError:
-        return {
-            "status": "fallback",
-            "reason": "Groq API unavailable; using template explanations",
-            "explanations": _fallback_explanations(trimmed_findings),
-        }
+        fallback = _fallback_explanations([findings[clusters[idx].members[0]] for idx in pending])
+        for idx in pending:
+            cwe_id = clusters[idx].cwe_ids[0] if clusters[idx].cwe_ids else ""
+            result_clusters[idx]["explanation"] = next(
+                (text for text in fallback if text.startswith(f"{cwe_id}:")), ""
+            )
+        return _result("fallback", reason="Groq API unavailable; using template explanations")
+
+    by_number = _split_numbered(content, len(pending))
+    if not by_number:
+        # Unnumbered reply: keep it whole rather than guess the split, and don't cache it.
+        if content.strip():
+            result_clusters[pending[0]]["explanation"] = content.strip()
+        return _result("ok", model=decision.model)
+    for n, idx in enumerate(pending, start=1):
+        text = by_number.get(n, "")
+        if text:
+            _cache_explanation((cache_model, clusters[idx].key), text)
+            result_clusters[idx]["explanation"] = text
+    return _result("ok", model=decision.model)
 
 
 def analyze_code(
     code_snippet: str,
-    model: str = "openai/gpt-oss-120b",
+    model: str | None = None,
 ) -> Dict[str, Any]:
-    api_key = os.getenv("GROQ_API_KEY", "")
+    api_key = _api_key()
     if not api_key:
         return {
             "status": "skipped",
@@ -101,19 +293,19 @@ def analyze_code(
         ),
     }
 
+    decision = _route(model, "llm_only", [prompt])
     payload = {
-        "model": model,
+        "model": decision.model,
         "messages": [prompt],
         "temperature": 0.2,
         "max_tokens": 300,
     }
 
     try:
-        response = _post_json(GROQ_ENDPOINT, payload, api_key)
-        content = response.get("choices", [{}])[0].get("message", {}).get("content", "")
+        content = _chat(payload, api_key, stage="llm_only", route=decision.reason)
         return {
             "status": "ok",
-            "model": model,
+            "model": decision.model,
             "analysis": content.strip(),
         }
     except RuntimeError:
@@ -124,14 +316,79 @@ def analyze_code(
         }
 
 
+_FINDING_FIELDS = ("issue", "severity", "line", "snippet", "fix", "rationale")
+_SEVERITIES = ("low", "medium", "high")
+
+UNKNOWN_FINDINGS_SCHEMA: Dict[str, Any] = {
+    "type": "object",
+    "properties": {
+        "findings": {
+            "type": "array",
+            "items": {
+                "type": "object",
+                "properties": {
+                    "issue": {"type": "string"},
+                    "severity": {"type": "string", "enum": list(_SEVERITIES)},
+                    "line": {"type": "integer"},
+                    "snippet": {"type": "string"},
+                    "fix": {"type": "string"},
+                    "rationale": {"type": "string"},
+                },
+                "required": list(_FINDING_FIELDS),
+                "additionalProperties": False,
+            },
+        }
+    },
+    "required": ["findings"],
+    "additionalProperties": False,
+}
+
+
+def validate_unknown_findings(data: Any) -> Dict[str, Any] | None:
+    """
+    Check a parsed response against UNKNOWN_FINDINGS_SCHEMA. Minor drift
+    (numeric strings, severity case) is coerced; anything else is rejected.
+    """
+    if not isinstance(data, dict) or not isinstance(data.get("findings"), list):
+        return None
+    findings = []
+    for item in data["findings"]:
+        if not isinstance(item, dict) or any(key not in item for key in _FINDING_FIELDS):
+            return None
+        severity = str(item["severity"]).lower()
+        if severity not in _SEVERITIES:
+            return None
+        try:
+            line = int(item["line"])
+        except (TypeError, ValueError):
+            return None
+        finding = {key: str(item[key]) for key in ("issue", "snippet", "fix", "rationale")}
+        findings.append({**finding, "severity": severity, "line": line})
+    return {"findings": findings}
+
+
+def _parse_structured(content: str) -> Dict[str, Any] | None:
+    try:
+        return validate_unknown_findings(json.loads(content))
+    except json.JSONDecodeError:
+        return None
+
+
 def analyze_unknown_findings(
     code_snippet: str,
-    model: str = "openai/gpt-oss-120b",
+    model: str | None = None,
     strict: bool = False,
     focus: List[str] | None = None,
     force: bool = False,
+    structured: bool = True,
 ) -> Dict[str, Any]:
-    api_key = os.getenv("GROQ_API_KEY", "")
+    """
+    With `structured`, the findings schema is sent as a JSON-schema response
+    format and the reply is validated here (`data`), so one call normally
+    suffices. Otherwise the schema is described in the prompt and `raw` is
+    left for the caller to parse.
+    """
+    api_key = _api_key()
     if not api_key:
         return {
             "status": "skipped",
@@ -160,17 +417,11 @@ def analyze_unknown_findings(
             "logic issue in the focus functions."
         )
 
-    user_prompt = {
-        "role": "user",
-        "content": (
-            "Find UNKNOWN or logic-based vulnerabilities (authorization, business logic, "
-            "workflow bypass, missing checks). Do NOT report classic signature issues like "
-            "SQLi/XSS/command injection/buffer overflow/memory leaks/uninitialized vars "
-            "or integer overflow. Only report if you can point to a clear control-flow flaw "
-            "or missing validation in the snippet. "
-            f"{focus_hint}"
-            f"{force_hint} "
-            f"{rules} "
+    if structured:
+        # The response format carries the schema; no need to spell it out.
+        format_hint = "Use the numbered line for `line`. If no issues, return an empty findings list.\n\n"
+    else:
+        format_hint = (
             "Return JSON only with this schema:\n"
             "{\n"
             "  \"findings\": [\n"
@@ -185,53 +436,85 @@ def analyze_unknown_findings(
             "  ]\n"
             "}\n"
             "If no issues, return {\"findings\": []}.\n\n"
+        )
+
+    user_prompt = {
+        "role": "user",
+        "content": (
+            "Find UNKNOWN or logic-based vulnerabilities (authorization, business logic, "
+            "workflow bypass, missing checks). Do NOT report classic signature issues like "
+            "SQLi/XSS/command injection/buffer overflow/memory leaks/uninitialized vars "
+            "or integer overflow. Only report if you can point to a clear control-flow flaw "
+            "or missing validation in the snippet. "
+            f"{focus_hint}"
+            f"{force_hint} "
+            f"{rules} "
+            f"{format_hint}"
             f"Code snippet:\n{code_snippet}\n"
         ),
     }
 
+    decision = _route(model, "stage2", [user_prompt])
     payload = {
-        "model": model,
+        "model": decision.model,
         "messages": [user_prompt],
         "temperature": 0.2,
         "max_tokens": 300 if strict else 500,
     }
+    if structured:
+        payload["response_format"] = {
+            "type": "json_schema",
+            "json_schema": {"name": "unknown_findings", "strict": True, "schema": UNKNOWN_FINDINGS_SCHEMA},
+        }
 
-    def _call(request_payload: Dict[str, Any]) -> str:
-        response = _post_json(GROQ_ENDPOINT, request_payload, api_key)
-        return response.get("choices", [{}])[0].get("message", {}).get("content", "").strip()
-
-    def _try_with_payload(request_payload: Dict[str, Any]) -> str:
-        content = _call(request_payload)
-        if content:
+    def _call(request_payload: Dict[str, Any], route: str = decision.reason) -> str:
+        try:
+            return _chat(request_payload, api_key, stage="stage2", route=route).strip()
+        except RuntimeError as exc:
+            if request_payload.get("response_format", {}).get("type") != "json_schema" or (
+                "response_format" not in str(exc) and "json_schema" not in str(exc)
+            ):
+                raise
+            # Model without JSON-schema support: JSON mode still guarantees an object.
+            json_mode = dict(request_payload, response_format={"type": "json_object"})
+            return _chat(json_mode, api_key, stage="stage2", route=f"{route}; json_object mode").strip()
+
+    def _try_with_payload(request_payload: Dict[str, Any], route: str = decision.reason) -> str:
+        content = _call(request_payload, route)
+        if content or structured:
             return content
         short_prompt = dict(user_prompt)
         short_prompt["content"] = short_prompt["content"].replace(code_snippet, code_snippet[:1000])
         retry_payload = dict(request_payload)
         retry_payload["messages"] = [short_prompt]
-        return _call(retry_payload)
+        return _call(retry_payload, f"{route}; truncated retry")
 
+    def _result(content: str, used_model: str) -> Dict[str, Any]:
+        result = {"status": "ok", "model": used_model, "raw": content}
+        if structured:
+            result["data"] = _parse_structured(content)
+        return result
+
+    fallback_route = f"fallback from {decision.model}"
+    # Every route runs on the same local model, so a fallback would only repeat the call.
+    local = api_key == "local"
     try:
         content = _try_with_payload(payload)
-        if not content:
+        if not content and not structured and not local:
             retry_payload = dict(payload)
-            retry_payload["model"] = "llama-3.1-8b-instant"
-            content = _try_with_payload(retry_payload)
-        return {
-            "status": "ok",
-            "model": model,
-            "raw": content,
-        }
+            retry_payload["model"] = decision.fallback
+            content = _try_with_payload(retry_payload, fallback_route)
+            return _result(content, decision.fallback)
+        return _result(content, decision.model)
     except RuntimeError as exc:
-        # Retry with smaller model on API error
+        if local:
+            return {"status": "error", "reason": f"Local model unavailable: {exc}", "findings": []}
+        # Retry with the router's fallback model on API error
         try:
             retry_payload = dict(payload)
-            retry_payload["model"] = "llama-3.1-8b-instant"
-            content = _try_with_payload(retry_payload)
-            return {
-                "status": "ok",
-                "model": "llama-3.1-8b-instant",
-                "raw": content,
-            }
+            retry_payload["model"] = decision.fallback
+            content = _try_with_payload(retry_payload, fallback_route)
+            return _result(content, decision.fallback)
         except RuntimeError as exc_retry:
             return {
                 "status": "error",
@@ -242,9 +525,9 @@ def analyze_unknown_findings(
 
 def analyze_future_risk(
     code_snippet: str,
-    model: str = "openai/gpt-oss-120b",
+    model: str | None = None,
 ) -> Dict[str, Any]:
-    api_key = os.getenv("GROQ_API_KEY", "")
+    api_key = _api_key()
     if not api_key:
         return {
             "status": "skipped",
@@ -264,19 +547,19 @@ def analyze_future_risk(
         ),
     }
 
+    decision = _route(model, "stage3", [prompt])
     payload = {
-        "model": model,
+        "model": decision.model,
         "messages": [prompt],
         "temperature": 0.2,
         "max_tokens": 250,
     }
 
     try:
-        response = _post_json(GROQ_ENDPOINT, payload, api_key)
-        content = response.get("choices", [{}])[0].get("message", {}).get("content", "")
+        content = _chat(payload, api_key, stage="stage3", route=decision.reason)
         return {
             "status": "ok",
-            "model": model,
+            "model": decision.model,
             "analysis": content.strip(),
         }
     except RuntimeError as exc:
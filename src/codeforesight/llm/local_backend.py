@@ -0,0 +1,138 @@
+from __future__ import annotations
+
+import importlib.util
+import os
+import queue
+import threading
+import time
+from concurrent.futures import Future
+from pathlib import Path
+from typing import Any, Dict, List, Tuple
+
+from codeforesight.config import LOCAL_LLM_MODEL_PATH
+
+DEFAULT_CONTEXT_TOKENS = 8192
+# Room for the KV state of several prompt prefixes (Stage 2, explain, Stage 3 instructions).
+PREFIX_CACHE_BYTES = 512 * 1024 * 1024
+# How long the worker waits for more requests before starting a batch.
+BATCH_WINDOW_S = 0.02
+
+
+def _response_format(payload: Dict[str, Any]) -> Dict[str, Any] | None:
+    """OpenAI-style response_format as llama.cpp takes it: the schema becomes a grammar."""
+    requested = payload.get("response_format")
+    if not requested:
+        return None
+    if requested.get("type") == "json_schema":
+        return {"type": "json_object", "schema": requested["json_schema"]["schema"]}
+    return {"type": "json_object"}
+
+
+class LocalBackend:
+    """
+    A quantized GGUF model run on CPU with llama.cpp, answering the same chat
+    payloads as the Groq API. One worker thread owns the model; requests that
+    arrive together are run as one batch, ordered so prompts sharing an
+    instruction prefix follow each other and reuse its evaluated KV state.
+    """
+
+    def __init__(self, model_path: Path, n_ctx: int = DEFAULT_CONTEXT_TOKENS, n_threads: int | None = None):
+        # Optional and slow to import; only loaded once a local call is made.
+        try:
+            import llama_cpp
+        except ImportError as exc:
+            raise RuntimeError("llama-cpp-python is not installed") from exc
+        self.model_name = local_model_name(model_path)
+        try:
+            self._llm = llama_cpp.Llama(
+                model_path=str(model_path),
+                n_ctx=n_ctx,
+                n_threads=n_threads or os.cpu_count(),
+                verbose=False,
+            )
+        except (OSError, ValueError) as exc:
+            raise RuntimeError(f"Cannot load local model {model_path}: {exc}") from exc
+        # Saved states for prefixes other than the last prompt's; llama.cpp
+        # already skips re-evaluating the prefix shared with the previous call.
+        self._llm.set_cache(llama_cpp.LlamaRAMCache(capacity_bytes=PREFIX_CACHE_BYTES))
+        self._requests: "queue.Queue[Tuple[Dict[str, Any], Future]]" = queue.Queue()
+        threading.Thread(target=self._serve, name="codeforesight-local-llm", daemon=True).start()
+
+    def complete(self, payload: Dict[str, Any]) -> Dict[str, Any]:
+        """Blocking chat completion; returns an OpenAI-format response."""
+        future: Future = Future()
+        self._requests.put((payload, future))
+        return future.result()
+
+    def _next_batch(self) -> List[Tuple[Dict[str, Any], Future]]:
+        batch = [self._requests.get()]
+        deadline = time.monotonic() + BATCH_WINDOW_S
+        while True:
+            try:
+                batch.append(self._requests.get(timeout=max(0.0, deadline - time.monotonic())))
+            except queue.Empty:
+                return batch
+
+    def _serve(self) -> None:
+        while True:
+            batch = self._next_batch()
+            batch.sort(key=lambda item: str(item[0].get("messages", [])))
+            for payload, future in batch:
+                if not future.set_running_or_notify_cancel():
+                    continue
+                try:
+                    future.set_result(self._run(payload))
+                except Exception as exc:
+                    future.set_exception(RuntimeError(f"Local model error: {exc}"))
+
+    def _run(self, payload: Dict[str, Any]) -> Dict[str, Any]:
+        response = self._llm.create_chat_completion(
+            messages=payload.get("messages", []),
+            temperature=payload.get("temperature", 0.2),
+            max_tokens=payload.get("max_tokens"),
+            response_format=_response_format(payload),
+        )
+        return {**response, "model": self.model_name}
+
+
+_BACKEND: LocalBackend | None = None
+# A failed load is remembered; retrying it on every call would only repeat the error slowly.
+_BACKEND_ERROR: RuntimeError | None = None
+_BACKEND_LOCK = threading.Lock()
+
+
+def local_model_name(model_path: Path = LOCAL_LLM_MODEL_PATH) -> str:
+    return f"local/{model_path.stem}"
+
+
+def local_backend_available(model_path: Path = LOCAL_LLM_MODEL_PATH) -> bool:
+    return model_path.exists() and importlib.util.find_spec("llama_cpp") is not None
+
+
+def get_local_backend(model_path: Path = LOCAL_LLM_MODEL_PATH) -> LocalBackend:
+    """Loads the model on first use; later calls share the instance, or the load error."""
+    global _BACKEND, _BACKEND_ERROR
+    with _BACKEND_LOCK:
+        if _BACKEND_ERROR is not None:
+            raise RuntimeError(str(_BACKEND_ERROR))
+        if _BACKEND is None:
+            threads = int(os.getenv("CODEFORESIGHT_LOCAL_THREADS", "0")) or None
+            try:
+                _BACKEND = LocalBackend(model_path, n_threads=threads)
+            except RuntimeError as exc:
+                _BACKEND_ERROR = exc
+                raise
+        return _BACKEND
+
+
+def llm_backend() -> str:
+    """
+    "groq" or "local", from CODEFORESIGHT_LLM_BACKEND. The default, "auto",
+    uses Groq when GROQ_API_KEY is set and the local model when it is not.
+    """
+    choice = os.getenv("CODEFORESIGHT_LLM_BACKEND", "auto").lower()
+    if choice in {"groq", "local"}:
+        return choice
+    if os.getenv("GROQ_API_KEY") or not local_backend_available():
+        return "groq"
+    return "local"
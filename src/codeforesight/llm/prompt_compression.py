@@ -0,0 +1,100 @@
+from __future__ import annotations
+
+import re
+from dataclasses import dataclass
+from pathlib import Path
+from typing import List
+
+from codeforesight.stages.function_splitter import is_python_source
+
+# BPE tokenizers split words into ~4-char pieces and most punctuation into single tokens.
+_TOKEN_PIECE_RE = re.compile(r"[A-Za-z]+|\d+|[^\sA-Za-z\d]")
+_C_COMMENT_RE = re.compile(
+    r"(\"(?:\\.|[^\"\\\n])*\"|'(?:\\.|[^'\\\n])*')|//[^\n]*|/\*.*?\*/",
+    re.DOTALL,
+)
+_PY_COMMENT_RE = re.compile(r"(\"(?:\\.|[^\"\\\n])*\"|'(?:\\.|[^'\\\n])*')|#[^\n]*")
+_LONG_STRING_RE = re.compile(r"(\"|')((?:\\.|(?!\1)[^\\\n]){60,})\1")
+_BANNER_RE = re.compile(r"^\W*([=\-*#/~_+])\1{7,}\W*$")
+MAX_LITERAL_CHARS = 24
+
+
+def estimate_tokens(text: str) -> int:
+    """Local approximation of a BPE token count; no tokenizer download needed."""
+    count = 0
+    for piece in _TOKEN_PIECE_RE.findall(text):
+        count += (len(piece) + 3) // 4 if piece[0].isalnum() else 1
+    return count + text.count("\n")
+
+
+@dataclass(frozen=True)
+class CompressedCode:
+    lines: List[str]
+    # Original 1-based line number of each kept line.
+    line_map: List[int]
+
+    def render(self, first: int = 1, last: int | None = None) -> str:
+        """Kept lines from original lines first..last, prefixed with their original numbers."""
+        rows = [
+            (number, line)
+            for number, line in zip(self.line_map, self.lines)
+            if number >= first and (last is None or number <= last)
+        ]
+        if not rows:
+            return ""
+        width = len(str(rows[-1][0]))
+        return "\n".join(f"{number:>{width}}| {line}" for number, line in rows)
+
+
+def _strip_comments(code: str, python: bool) -> str:
+    pattern = _PY_COMMENT_RE if python else _C_COMMENT_RE
+
+    def _replace(match: re.Match) -> str:
+        if match.group(1):
+            return match.group(1)
+        # Keep newlines so line numbers still line up.
+        return "\n" * match.group(0).count("\n")
+
+    return pattern.sub(_replace, code)
+
+
+def _shorten_literal(match: re.Match) -> str:
+    quote, body = match.group(1), match.group(2)
+    return f"{quote}{body[:MAX_LITERAL_CHARS]}...{quote}"
+
+
+def compress_code(code: str, path: Path | None = None) -> CompressedCode:
+    """
+    Drop comments, blank lines and banner lines, shorten long literals,
+    shrink indentation to one space per level and fold runs of identical
+    lines into one, keeping the original line number of every kept line.
+    """
+    python = is_python_source(path, code)
+    raw_lines = _strip_comments(code, python).splitlines()
+    indents = [
+        len(line.expandtabs(4)) - len(line.expandtabs(4).lstrip())
+        for line in raw_lines
+        if line.strip()
+    ]
+    unit = min((i for i in indents if i), default=1)
+
+    lines: List[str] = []
+    line_map: List[int] = []
+    previous = None
+    repeats = 0
+    for number, line in enumerate(raw_lines, start=1):
+        expanded = line.expandtabs(4).rstrip()
+        body = expanded.lstrip()
+        if not body or _BANNER_RE.match(body):
+            continue
+        indent = (len(expanded) - len(body)) // unit
+        compact = " " * indent + _LONG_STRING_RE.sub(_shorten_literal, body)
+        if compact == previous:
+            repeats += 1
+            lines[-1] = f"{compact}  [x{repeats + 1}]"
+            continue
+        previous = compact
+        repeats = 0
+        lines.append(compact)
+        line_map.append(number)
+    return CompressedCode(lines, line_map)
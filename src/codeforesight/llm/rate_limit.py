@@ -0,0 +1,88 @@
+from __future__ import annotations
+
+import os
+import threading
+import time
+from contextlib import contextmanager
+from typing import Iterator
+
+from codeforesight.metrics import LLM_QUEUE_DEPTH, RATE_LIMIT_WAIT_SECONDS
+
+DEFAULT_REQUESTS_PER_MINUTE = 30
+DEFAULT_MAX_CONCURRENT = 4
+
+
+class RateLimiter:
+    """
+    Token buckets for requests and (optionally) tokens per minute, plus a cap
+    on calls in flight. Shared by every thread that talks to the API.
+    """
+
+    def __init__(
+        self,
+        requests_per_minute: float,
+        tokens_per_minute: float | None = None,
+        max_concurrent: int = DEFAULT_MAX_CONCURRENT,
+    ):
+        self.requests_per_minute = requests_per_minute
+        self.tokens_per_minute = tokens_per_minute
+        self._requests = float(requests_per_minute)
+        self._tokens = float(tokens_per_minute or 0)
+        self._updated = time.monotonic()
+        self._cond = threading.Condition()
+        self._in_flight = threading.BoundedSemaphore(max(1, max_concurrent))
+
+    def _refill(self, now: float) -> None:
+        elapsed = now - self._updated
+        self._updated = now
+        self._requests = min(self.requests_per_minute, self._requests + elapsed * self.requests_per_minute / 60)
+        if self.tokens_per_minute:
+            self._tokens = min(self.tokens_per_minute, self._tokens + elapsed * self.tokens_per_minute / 60)
+
+    def _wait_time(self, tokens: int) -> float:
+        wait = 0.0
+        if self._requests < 1:
+            wait = (1 - self._requests) * 60 / self.requests_per_minute
+        if self.tokens_per_minute:
+            # A single call larger than the whole budget waits for a full bucket, then goes.
+            needed = min(tokens, self.tokens_per_minute)
+            if self._tokens < needed:
+                wait = max(wait, (needed - self._tokens) * 60 / self.tokens_per_minute)
+        return wait
+
+    @contextmanager
+    def slot(self, tokens: int) -> Iterator[None]:
+        waiting = time.perf_counter()
+        LLM_QUEUE_DEPTH.inc()
+        with self._in_flight:
+            with self._cond:
+                while True:
+                    self._refill(time.monotonic())
+                    wait = self._wait_time(tokens)
+                    if wait <= 0:
+                        break
+                    self._cond.wait(wait)
+                self._requests -= 1
+                if self.tokens_per_minute:
+                    self._tokens -= min(tokens, self.tokens_per_minute)
+            RATE_LIMIT_WAIT_SECONDS.observe(time.perf_counter() - waiting)
+            LLM_QUEUE_DEPTH.dec()
+            yield
+
+
+_LIMITER: RateLimiter | None = None
+_LIMITER_LOCK = threading.Lock()
+
+
+def get_rate_limiter() -> RateLimiter:
+    """Built on first use so limits from .env (GROQ_RPM, GROQ_TPM, GROQ_MAX_CONCURRENCY) apply."""
+    global _LIMITER
+    with _LIMITER_LOCK:
+        if _LIMITER is None:
+            tpm = float(os.getenv("GROQ_TPM", "0"))
+            _LIMITER = RateLimiter(
+                requests_per_minute=float(os.getenv("GROQ_RPM", DEFAULT_REQUESTS_PER_MINUTE)),
+                tokens_per_minute=tpm or None,
+                max_concurrent=int(os.getenv("GROQ_MAX_CONCURRENCY", DEFAULT_MAX_CONCURRENT)),
+            )
+        return _LIMITER
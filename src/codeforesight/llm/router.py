@@ -0,0 +1,142 @@
+from __future__ import annotations
+
+import threading
+import time
+from contextlib import contextmanager
+from contextvars import ContextVar
+from dataclasses import dataclass
+from typing import Dict, Iterator, List
+
+
+@dataclass(frozen=True)
+class ModelProfile:
+    name: str
+    context_tokens: int
+    # Latency prior (ms) until real calls have been observed.
+    prior_latency_ms: float
+
+
+LARGE_MODEL = ModelProfile("openai/gpt-oss-120b", context_tokens=131072, prior_latency_ms=4000.0)
+SMALL_MODEL = ModelProfile("llama-3.1-8b-instant", context_tokens=131072, prior_latency_ms=800.0)
+MODELS = {profile.name: profile for profile in (LARGE_MODEL, SMALL_MODEL)}
+
+# Stage 2 gates CI, so it gets the stronger model; the rest only explain.
+GATING_STAGES = {"stage2"}
+# Explanations with this much context still go to the large model.
+LARGE_PROMPT_TOKENS = 6000
+MAX_ERROR_RATE = 0.5
+MIN_OBSERVATIONS = 3
+_EWMA_ALPHA = 0.3
+# An avoided model gets no new observations, so its error rate decays with
+# idle time; once below MAX_ERROR_RATE it is tried again.
+ERROR_HALF_LIFE_S = 30.0
+
+
+@dataclass(frozen=True)
+class RouteDecision:
+    model: str
+    fallback: str
+    reason: str
+
+
+class _ModelStats:
+    def __init__(self, prior_latency_ms: float):
+        self.latency_ms = prior_latency_ms
+        self.error_rate = 0.0
+        self.observations = 0
+        self.updated_at = time.monotonic()
+
+    def current_error_rate(self, now: float) -> float:
+        idle_s = max(0.0, now - self.updated_at)
+        return self.error_rate * 0.5 ** (idle_s / ERROR_HALF_LIFE_S)
+
+    def observe(self, latency_ms: float, ok: bool) -> None:
+        now = time.monotonic()
+        if ok:
+            self.latency_ms += _EWMA_ALPHA * (latency_ms - self.latency_ms)
+        error_rate = self.current_error_rate(now)
+        self.error_rate = error_rate + _EWMA_ALPHA * ((0.0 if ok else 1.0) - error_rate)
+        self.observations += 1
+        self.updated_at = now
+
+
+class ModelRouter:
+    """Chooses a model per call from stage, prompt size, deadline and observed health."""
+
+    def __init__(self, models: Dict[str, ModelProfile] | None = None):
+        self.models = models or MODELS
+        self._stats = {name: _ModelStats(p.prior_latency_ms) for name, p in self.models.items()}
+        self._lock = threading.Lock()
+
+    def observe(self, model: str, latency_ms: float, ok: bool) -> None:
+        with self._lock:
+            stats = self._stats.get(model)
+            if stats is not None:
+                stats.observe(latency_ms, ok)
+
+    def _healthy(self, model: str) -> bool:
+        stats = self._stats[model]
+        return stats.observations < MIN_OBSERVATIONS or stats.current_error_rate(time.monotonic()) <= MAX_ERROR_RATE
+
+    def route(self, stage: str, prompt_tokens: int, remaining_ms: float | None = None) -> RouteDecision:
+        large, small = LARGE_MODEL.name, SMALL_MODEL.name
+        with self._lock:
+            if prompt_tokens > self.models[small].context_tokens:
+                preferred, reason = large, "prompt exceeds small model context"
+            elif stage in GATING_STAGES:
+                preferred, reason = large, "gating stage"
+            elif prompt_tokens >= LARGE_PROMPT_TOKENS:
+                preferred, reason = large, f"large prompt ({prompt_tokens} tokens)"
+            else:
+                preferred, reason = small, "explanatory stage"
+            other = small if preferred == large else large
+
+            if not self._healthy(preferred) and self._healthy(other):
+                error_rate = self._stats[preferred].current_error_rate(time.monotonic())
+                preferred, other = other, preferred
+                reason += f"; {other} error rate {error_rate:.0%}"
+            if (
+                remaining_ms is not None
+                and preferred == large
+                and self._stats[large].latency_ms > remaining_ms
+                # Even if neither fits any more, the faster model misses the deadline by less.
+                and self._stats[small].latency_ms < self._stats[large].latency_ms
+            ):
+                preferred, other = small, large
+                reason += f"; {remaining_ms:.0f} ms left < {large} latency {self._stats[large].latency_ms:.0f} ms"
+        return RouteDecision(model=preferred, fallback=other, reason=reason)
+
+    def snapshot(self) -> List[Dict[str, float | str | int]]:
+        now = time.monotonic()
+        with self._lock:
+            return [
+                {
+                    "model": name,
+                    "latency_ms": round(stats.latency_ms, 1),
+                    "error_rate": round(stats.current_error_rate(now), 3),
+                    "observations": stats.observations,
+                }
+                for name, stats in self._stats.items()
+            ]
+
+
+ROUTER = ModelRouter()
+
+_DEADLINE: ContextVar[float | None] = ContextVar("codeforesight_llm_deadline", default=None)
+
+
+@contextmanager
+def llm_deadline(seconds: float | None) -> Iterator[None]:
+    """Calls made inside the block route to faster models as the deadline nears."""
+    token = _DEADLINE.set(time.monotonic() + seconds if seconds else None)
+    try:
+        yield
+    finally:
+        _DEADLINE.reset(token)
+
+
+def remaining_ms() -> float | None:
+    deadline = _DEADLINE.get()
+    if deadline is None:
+        return None
+    return max(0.0, (deadline - time.monotonic()) * 1000)
@@ -0,0 +1,78 @@
+from __future__ import annotations
+
+import threading
+from contextlib import contextmanager
+from contextvars import ContextVar
+from dataclasses import asdict, dataclass
+from typing import Any, Dict, Iterator, List
+
+from codeforesight.metrics import LLM_CALLS, LLM_SECONDS, LLM_TOKENS
+
+
+@dataclass(frozen=True)
+class LlmCall:
+    stage: str
+    model: str
+    status: str
+    prompt_tokens: int
+    completion_tokens: int
+    latency_ms: float
+    # True when the API reported no usage and the local estimator was used.
+    estimated: bool
+    # Why the router picked this model ("pinned" when the caller named one).
+    route: str = ""
+
+
+class UsageLedger:
+    """LLM calls made while a report is being built."""
+
+    def __init__(self) -> None:
+        self.calls: List[LlmCall] = []
+        self._lock = threading.Lock()
+
+    def record(self, call: LlmCall) -> None:
+        with self._lock:
+            self.calls.append(call)
+
+    @staticmethod
+    def _totals(calls: List[LlmCall]) -> Dict[str, Any]:
+        return {
+            "calls": len(calls),
+            "prompt_tokens": sum(c.prompt_tokens for c in calls),
+            "completion_tokens": sum(c.completion_tokens for c in calls),
+            "latency_ms": round(sum(c.latency_ms for c in calls), 1),
+        }
+
+    def summary(self) -> Dict[str, Any]:
+        with self._lock:
+            calls = list(self.calls)
+        stages = sorted({c.stage for c in calls})
+        return {
+            "totals": self._totals(calls),
+            "by_stage": {stage: self._totals([c for c in calls if c.stage == stage]) for stage in stages},
+            "calls": [asdict(c) for c in calls],
+        }
+
+
+_CURRENT: ContextVar[UsageLedger | None] = ContextVar("codeforesight_llm_usage", default=None)
+
+
+@contextmanager
+def track_usage() -> Iterator[UsageLedger]:
+    ledger = UsageLedger()
+    token = _CURRENT.set(ledger)
+    try:
+        yield ledger
+    finally:
+        _CURRENT.reset(token)
+
+
+def record_call(call: LlmCall) -> None:
+    LLM_CALLS.inc(stage=call.stage, model=call.model, status=call.status)
+    if call.status != "shared":
+        LLM_TOKENS.inc(call.prompt_tokens, model=call.model, kind="prompt")
+        LLM_TOKENS.inc(call.completion_tokens, model=call.model, kind="completion")
+        LLM_SECONDS.observe(call.latency_ms / 1000, model=call.model)
+    ledger = _CURRENT.get()
+    if ledger is not None:
+        ledger.record(call)
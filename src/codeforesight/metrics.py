@@ -0,0 +1,296 @@
+from __future__ import annotations
+
+import threading
+import time
+import weakref
+from contextlib import contextmanager
+from typing import TYPE_CHECKING, Callable, Dict, Iterator, List, Sequence, Tuple
+
+if TYPE_CHECKING:
+    from http.server import ThreadingHTTPServer
+
+LabelKey = Tuple[Tuple[str, str], ...]
+
+# Seconds; spans a cached lookup up to a slow LLM call.
+DEFAULT_BUCKETS = (0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0)
+
+
+def _label_key(labels: Dict[str, object]) -> LabelKey:
+    return tuple(sorted((name, str(value)) for name, value in labels.items()))
+
+
+def _format_labels(key: LabelKey, extra: Sequence[Tuple[str, str]] = ()) -> str:
+    pairs = list(key) + list(extra)
+    if not pairs:
+        return ""
+    escaped = (value.replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n") for _, value in pairs)
+    return "{" + ",".join(f'{name}="{value}"' for (name, _), value in zip(pairs, escaped)) + "}"
+
+
+def _add_counts(base: Dict, shard: Dict) -> None:
+    for key, value in shard.items():
+        base[key] = base.get(key, 0.0) + value
+
+
+def _add_buckets(base: Dict, shard: Dict) -> None:
+    for key, state in shard.items():
+        merged = base.setdefault(key, [0] * len(state))
+        for idx, value in enumerate(state):
+            merged[idx] += value
+
+
+class _Owner:
+    """Held only by the thread-local, so it dies with its thread."""
+
+    __slots__ = ("shard", "__weakref__")
+
+
+class _Shards:
+    """
+    One dict per thread. Updates touch only the calling thread's dict, so the
+    hot path takes no lock; readers sum all shards at scrape time. When a
+    thread exits its shard is folded into a base total, so short-lived pool
+    threads don't accumulate.
+    """
+
+    def __init__(self, merge: Callable[[Dict, Dict], None]) -> None:
+        self._local = threading.local()
+        self._merge = merge
+        self._base: Dict = {}
+        self._live: Dict[int, Dict] = {}
+        self._lock = threading.Lock()
+
+    def mine(self) -> Dict:
+        owner = getattr(self._local, "owner", None)
+        if owner is None:
+            owner = self._local.owner = _Owner()
+            owner.shard = {}
+            with self._lock:
+                self._live[id(owner.shard)] = owner.shard
+            weakref.finalize(owner, self._retire, owner.shard)
+        return owner.shard
+
+    def _retire(self, shard: Dict) -> None:
+        with self._lock:
+            self._live.pop(id(shard), None)
+            self._merge(self._base, shard)
+
+    def snapshot(self) -> List[Dict]:
+        # Under the lock so a shard is never counted both live and in the base.
+        with self._lock:
+            copies = [self._copy(self._base)]
+            copies.extend(self._copy(shard) for shard in self._live.values())
+        return copies
+
+    def totals(self) -> Dict:
+        merged: Dict = {}
+        for shard in self.snapshot():
+            self._merge(merged, shard)
+        return merged
+
+    def absorb(self, data: Dict) -> None:
+        """Add counts recorded elsewhere (a worker process) to the base total."""
+        with self._lock:
+            self._merge(self._base, data)
+
+    @staticmethod
+    def _copy(shard: Dict) -> Dict:
+        # The owning thread may add a key while we copy; retry.
+        while True:
+            try:
+                return dict(shard)
+            except RuntimeError:
+                continue
+
+
+class Counter:
+    kind = "counter"
+
+    def __init__(self, name: str, help_text: str):
+        self.name = name
+        self.help = help_text
+        self._shards = _Shards(_add_counts)
+
+    def inc(self, amount: float = 1.0, **labels: object) -> None:
+        shard = self._shards.mine()
+        key = _label_key(labels)
+        shard[key] = shard.get(key, 0.0) + amount
+
+    def samples(self) -> List[str]:
+        totals: Dict[LabelKey, float] = self._shards.totals()
+        return [f"{self.name}{_format_labels(key)} {value:g}" for key, value in sorted(totals.items())]
+
+    def total(self) -> float:
+        """Sum over all label sets; cheap enough to sample once a second."""
+        return sum(sum(shard.values()) for shard in self._shards.snapshot())
+
+
+class Level(Counter):
+    """A sharded gauge that moves both ways (e.g. calls waiting), still lock-free to update."""
+
+    kind = "gauge"
+
+    def dec(self, amount: float = 1.0, **labels: object) -> None:
+        self.inc(-amount, **labels)
+
+
+class Histogram:
+    kind = "histogram"
+
+    def __init__(self, name: str, help_text: str, buckets: Sequence[float] = DEFAULT_BUCKETS):
+        self.name = name
+        self.help = help_text
+        self.buckets = tuple(buckets)
+        self._shards = _Shards(_add_buckets)
+
+    def observe(self, value: float, **labels: object) -> None:
+        shard = self._shards.mine()
+        key = _label_key(labels)
+        state = shard.get(key)
+        if state is None:
+            # Per-bucket counts, then count and sum.
+            state = shard[key] = [0] * len(self.buckets) + [0, 0.0]
+        for idx, bound in enumerate(self.buckets):
+            if value <= bound:
+                state[idx] += 1
+                break
+        state[-2] += 1
+        state[-1] += value
+
+    @contextmanager
+    def time(self, **labels: object) -> Iterator[None]:
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.observe(time.perf_counter() - start, **labels)
+
+    def samples(self) -> List[str]:
+        totals: Dict[LabelKey, List[float]] = self._shards.totals()
+        lines = []
+        for key, state in sorted(totals.items()):
+            cumulative = 0
+            for bound, count in zip(self.buckets, state):
+                cumulative += count
+                lines.append(f"{self.name}_bucket{_format_labels(key, [('le', f'{bound:g}')])} {cumulative:g}")
+            lines.append(f"{self.name}_bucket{_format_labels(key, [('le', '+Inf')])} {state[-2]:g}")
+            lines.append(f"{self.name}_count{_format_labels(key)} {state[-2]:g}")
+            lines.append(f"{self.name}_sum{_format_labels(key)} {state[-1]:g}")
+        return lines
+
+
+class Gauge:
+    """Set rarely (e.g. on reload), so a plain dict assignment is enough."""
+
+    kind = "gauge"
+
+    def __init__(self, name: str, help_text: str):
+        self.name = name
+        self.help = help_text
+        self._values: Dict[LabelKey, float] = {}
+
+    def set(self, value: float, **labels: object) -> None:
+        self._values[_label_key(labels)] = value
+
+    def replace(self, value: float, **labels: object) -> None:
+        """Set one series and drop the others (info-style gauges such as the active version)."""
+        self._values = {_label_key(labels): value}
+
+    def samples(self) -> List[str]:
+        return [f"{self.name}{_format_labels(key)} {value:g}" for key, value in sorted(dict(self._values).items())]
+
+
+FILES_SCANNED = Counter("codeforesight_files_scanned_total", "Files scanned, by outcome.")
+BYTES_SCANNED = Counter("codeforesight_bytes_scanned_total", "Source bytes scanned.")
+STAGE_SECONDS = Histogram("codeforesight_stage_seconds", "Wall time per pipeline stage.")
+CACHE_REQUESTS = Counter("codeforesight_cache_requests_total", "Cache lookups, by cache and hit/miss.")
+LLM_CALLS = Counter("codeforesight_llm_calls_total", "LLM calls, by stage, model and status.")
+LLM_TOKENS = Counter("codeforesight_llm_tokens_total", "LLM tokens, by model and kind.")
+LLM_SECONDS = Histogram("codeforesight_llm_call_seconds", "LLM call latency, by model.")
+FINDINGS = Counter("codeforesight_findings_total", "Findings reported, by stage.")
+LLM_QUEUE_DEPTH = Level("codeforesight_llm_queue_depth", "LLM calls waiting for the rate limiter.")
+RATE_LIMIT_WAIT_SECONDS = Histogram(
+    "codeforesight_rate_limit_wait_seconds", "Time calls waited for the LLM rate limiter."
+)
+ARTIFACT_RELOADS = Counter("codeforesight_artifact_reloads_total", "Hot reloads of models and rules, by result.")
+ARTIFACT_VERSION = Gauge("codeforesight_artifact_version_info", "Active model and rule artifact version (value 1).")
+
+METRICS = [
+    FILES_SCANNED,
+    BYTES_SCANNED,
+    STAGE_SECONDS,
+    FINDINGS,
+    CACHE_REQUESTS,
+    LLM_CALLS,
+    LLM_TOKENS,
+    LLM_SECONDS,
+    LLM_QUEUE_DEPTH,
+    RATE_LIMIT_WAIT_SECONDS,
+    ARTIFACT_RELOADS,
+    ARTIFACT_VERSION,
+]
+
+
+def metrics_state() -> Dict[str, Dict]:
+    """Totals of every counter and histogram, keyed by metric name."""
+    return {m.name: m._shards.totals() for m in METRICS if isinstance(m, (Counter, Histogram))}
+
+
+def metrics_delta(before: Dict[str, Dict], after: Dict[str, Dict]) -> Dict[str, Dict]:
+    """What was recorded between two `metrics_state` calls; small enough to pickle per task."""
+    delta: Dict[str, Dict] = {}
+    for name, totals in after.items():
+        prior = before.get(name, {})
+        changed: Dict = {}
+        for key, value in totals.items():
+            if isinstance(value, list):
+                diff = [a - b for a, b in zip(value, prior.get(key, [0] * len(value)))]
+                if any(diff):
+                    changed[key] = diff
+            elif value != prior.get(key, 0.0):
+                changed[key] = value - prior.get(key, 0.0)
+        if changed:
+            delta[name] = changed
+    return delta
+
+
+def merge_metrics(delta: Dict[str, Dict]) -> None:
+    """Fold a worker process's `metrics_delta` into this process's metrics."""
+    for metric in METRICS:
+        if metric.name in delta:
+            metric._shards.absorb(delta[metric.name])
+
+
+def render_metrics() -> str:
+    """Prometheus text exposition format (0.0.4)."""
+    lines: List[str] = []
+    for metric in METRICS:
+        lines.append(f"# HELP {metric.name} {metric.help}")
+        lines.append(f"# TYPE {metric.name} {metric.kind}")
+        lines.extend(metric.samples())
+    return "\n".join(lines) + "\n"
+
+
+def serve_metrics(port: int, host: str = "0.0.0.0") -> "ThreadingHTTPServer":
+    """Serve /metrics from a daemon thread; returns the server so callers can shut it down."""
+    # Only the long-running scanner serves metrics; keep http.server off the CLI's import path.
+    from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+    class _MetricsHandler(BaseHTTPRequestHandler):
+        def do_GET(self) -> None:
+            if self.path.split("?", 1)[0] != "/metrics":
+                self.send_error(404)
+                return
+            body = render_metrics().encode("utf-8")
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, format: str, *args: object) -> None:
+            pass
+
+    server = ThreadingHTTPServer((host, port), _MetricsHandler)
+    threading.Thread(target=server.serve_forever, name="codeforesight-metrics", daemon=True).start()
+    return server
@@ -1,15 +1,33 @@
 from __future__ import annotations
 
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor, as_completed
 from dataclasses import asdict
+from functools import partial
 from pathlib import Path
-from typing import Any, Dict
+from typing import Any, Dict, List, Sequence, Tuple
 
+from codeforesight.data.shared_models import enable_shared_models
+from codeforesight.llm.context_windows import (
+    DEFAULT_CONTEXT_RADIUS,
+    DEFAULT_CONTEXT_TOKENS,
+    build_finding_context,
+)
+from codeforesight.llm.finding_clusters import cluster_findings, fan_out
 from codeforesight.llm.groq_client import analyze_code as groq_analyze
 from codeforesight.llm.groq_client import analyze_future_risk
 from codeforesight.llm.groq_client import explain_findings as groq_explain
-from codeforesight.stages.stage1_known import analyze_known
-from codeforesight.stages.stage2_unknown import analyze_unknown
-from codeforesight.stages.stage3_future import analyze_future
+from codeforesight.llm.prompt_compression import compress_code
+from codeforesight.llm.router import ROUTER, llm_deadline
+from codeforesight.llm.usage import track_usage
+from codeforesight.metrics import (
+    BYTES_SCANNED,
+    FILES_SCANNED,
+    FINDINGS,
+    STAGE_SECONDS,
+    merge_metrics,
+    metrics_delta,
+    metrics_state,
+)
 
 
 def run_pipeline(
@@ -20,12 +38,115 @@ def run_pipeline(
     stage1_only: bool = False,
     stage2_only: bool = False,
     stage3_only: bool = False,
+    context_radius: int = DEFAULT_CONTEXT_RADIUS,
+    context_tokens: int = DEFAULT_CONTEXT_TOKENS,
+    deadline_s: float | None = None,
+) -> Dict[str, Any]:
+    with track_usage() as usage, llm_deadline(deadline_s):
+        try:
+            report = _run_stages(
+                input_path,
+                explain=explain,
+                max_explain=max_explain,
+                llm_only=llm_only,
+                stage1_only=stage1_only,
+                stage2_only=stage2_only,
+                stage3_only=stage3_only,
+                context_radius=context_radius,
+                context_tokens=context_tokens,
+            )
+        except Exception:
+            FILES_SCANNED.inc(status="error")
+            raise
+    _count_scan(input_path, report)
+    report["llm_usage"] = {**usage.summary(), "router": ROUTER.snapshot()}
+    return report
+
+
+def _count_scan(input_path: Path, report: Dict[str, Any]) -> None:
+    FILES_SCANNED.inc(status="ok")
+    BYTES_SCANNED.inc(input_path.stat().st_size)
+    for stage in ("stage1_known", "stage2_unknown"):
+        findings = report.get(stage, {}).get("findings")
+        if findings:
+            FINDINGS.inc(len(findings), stage=stage.split("_", 1)[0])
+
+
+def _scan_file(path: Path, options: Dict[str, Any]) -> Dict[str, Any]:
+    """One file of a batch: a failure becomes that file's error report instead of aborting the batch."""
+    try:
+        return run_pipeline(path, **options)
+    except Exception as exc:
+        return {"input": str(path), "status": "error", "reason": f"{type(exc).__name__}: {exc}"}
+
+
+def _scan_file_with_metrics(path: Path, options: Dict[str, Any]) -> Tuple[Dict[str, Any], Dict[str, Dict]]:
+    """Process-pool task: the report plus the metrics recorded for it, which the parent merges."""
+    # A worker process runs one task at a time, so the delta belongs to this file.
+    before = metrics_state()
+    report = _scan_file(path, options)
+    return report, metrics_delta(before, metrics_state())
+
+
+def scan_paths(
+    paths: Sequence[Path],
+    workers: int = 4,
+    processes: bool = False,
+    **options: Any,
+) -> List[Dict[str, Any]]:
+    """
+    `run_pipeline` over several files; reports come back in input order.
+    Threads by default. With `processes`, models are memory-mapped so the
+    workers share one copy of their weights. Each file keeps its own usage
+    ledger and deadline. A file that fails gets an error report.
+    """
+    if len(paths) == 1:
+        return [run_pipeline(paths[0], **options)]
+    scan_one = partial(_scan_file, options=options)
+    if workers <= 1:
+        return [scan_one(path) for path in paths]
+    if processes:
+        enable_shared_models()
+        reports: List[Dict[str, Any]] = [{} for _ in paths]
+        with ProcessPoolExecutor(max_workers=min(workers, len(paths))) as pool:
+            futures = {pool.submit(_scan_file_with_metrics, path, options): idx for idx, path in enumerate(paths)}
+            # Merge in completion order so progress moves as files finish, not behind the slowest early one.
+            for future in as_completed(futures):
+                report, delta = future.result()
+                merge_metrics(delta)
+                reports[futures[future]] = report
+        return reports
+    with ThreadPoolExecutor(max_workers=min(workers, len(paths))) as pool:
+        return list(pool.map(scan_one, paths))
+
+
+def _run_stages(
+    input_path: Path,
+    explain: bool,
+    max_explain: int,
+    llm_only: bool,
+    stage1_only: bool,
+    stage2_only: bool,
+    stage3_only: bool,
+    context_radius: int,
+    context_tokens: int,
 ) -> Dict[str, Any]:
     code = input_path.read_text(encoding="utf-8", errors="ignore")
+    # Comment-free, line-numbered code for prompts; original numbers are kept.
+    compressed = compress_code(code, input_path)
+
+    # Only the stages the requested output needs run. Stage modules are imported
+    # here so that Stage 2-only and LLM-only runs never load sklearn or the models.
+    run_stage1 = not (llm_only or stage2_only)
+    run_stage3 = not (stage1_only or stage2_only)
+    explain_stage1 = explain and not (stage2_only or stage3_only)
 
     stage1_findings = []
-    if not llm_only:
-        stage1_findings = [asdict(f) for f in analyze_known(code, str(input_path))]
+    if run_stage1:
+        from codeforesight.stages.stage1_known import analyze_known
+
+        with STAGE_SECONDS.time(stage="stage1"):
+            stage1_findings = [asdict(f) for f in analyze_known(code, str(input_path))]
     cwe_counts: Dict[str, int] = {}
     for finding in stage1_findings:
         cwe = finding.get("cwe_id", "UNKNOWN")
@@ -37,31 +158,23 @@ def run_pipeline(
         "reason": "LLM explanations disabled",
         "explanations": [],
     }
-    snippet = "\n".join(code.splitlines()[:120])
-    if llm_only and explain:
-        stage1_explanations = groq_analyze(code_snippet=snippet)
-    elif explain and stage1_findings:
-        stage1_explanations = groq_explain(
-            stage1_findings,
-            code_snippet=snippet,
-            max_findings=max_explain,
-        )
-
-    stage2_result = analyze_unknown(code)
-    stage2_clean = dict(stage2_result)
-    stage2_clean.pop("model", None)
-    stage3_result = analyze_future(code, stage1_findings, stage2_result.get("findings", []))
-    stage3_explanation = {
-        "status": "skipped",
-        "reason": "LLM explanations disabled",
-        "analysis": "",
-    }
-    if explain:
-        stage3_explanation = analyze_future_risk("\n".join(code.splitlines()[:120]))
-    stage1_explanations_list = stage1_explanations.get("explanations", []) or []
-    stage3_explanations_list = []
-    if stage3_explanation.get("analysis"):
-        stage3_explanations_list = [stage3_explanation.get("analysis", "")]
+    snippet = compressed.render(1, 120)
+    if llm_only and explain_stage1:
+        with STAGE_SECONDS.time(stage="stage1_explain"):
+            stage1_explanations = groq_analyze(code_snippet=snippet)
+    elif explain_stage1 and stage1_findings:
+        # Only the code around the findings that will actually be explained.
+        explained_lines = [
+            stage1_findings[cluster.members[0]].get("line", 0)
+            for cluster in cluster_findings(stage1_findings)[:max_explain]
+        ]
+        with STAGE_SECONDS.time(stage="stage1_explain"):
+            stage1_explanations = groq_explain(
+                stage1_findings,
+                code_snippet=build_finding_context(compressed, explained_lines, context_radius, context_tokens),
+                max_findings=max_explain,
+            )
+        stage1_findings = fan_out(stage1_findings, stage1_explanations.get("clusters", []))
 
     if stage1_only:
         return {
@@ -73,16 +186,39 @@ def run_pipeline(
                     "top_cwe": top_cwe,
                     "total_findings": len(stage1_findings),
                 },
-                "explanations": stage1_explanations_list,
+                "explanations": stage1_explanations.get("explanations", []) or [],
             },
         }
 
-    if stage2_only:
+    from codeforesight.stages.stage2_unknown import analyze_unknown
+
+    with STAGE_SECONDS.time(stage="stage2"):
+        stage2_result = analyze_unknown(code, compressed, input_path)
+    stage2_clean = dict(stage2_result)
+    stage2_clean.pop("model", None)
+    if not run_stage3:
         return {
             "input": str(input_path),
             "stage2_unknown": stage2_clean,
         }
 
+    from codeforesight.stages.stage3_future import analyze_future
+
+    with STAGE_SECONDS.time(stage="stage3"):
+        stage3_result = analyze_future(code, stage1_findings, stage2_result.get("findings", []))
+    stage3_explanation = {
+        "status": "skipped",
+        "reason": "LLM explanations disabled",
+        "analysis": "",
+    }
+    if explain:
+        with STAGE_SECONDS.time(stage="stage3_explain"):
+            stage3_explanation = analyze_future_risk(snippet)
+    stage1_explanations_list = stage1_explanations.get("explanations", []) or []
+    stage3_explanations_list = []
+    if stage3_explanation.get("analysis"):
+        stage3_explanations_list = [stage3_explanation.get("analysis", "")]
+
     if stage3_only:
         return {
             "input": str(input_path),
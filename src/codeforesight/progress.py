@@ -0,0 +1,103 @@
+from __future__ import annotations
+
+import json
+import sys
+import threading
+import time
+from pathlib import Path
+from typing import Any, Dict, Sequence, TextIO
+
+from codeforesight.metrics import BYTES_SCANNED, FILES_SCANNED, FINDINGS, LLM_QUEUE_DEPTH
+
+DEFAULT_INTERVAL_SECONDS = 1.0
+
+
+class ProgressReporter:
+    """
+    Prints scan progress to `stream` from its own thread. It samples the
+    metrics counters once per interval, so scanning pays nothing extra.
+    Text mode rewrites one status line; JSON mode emits one event per line.
+    """
+
+    def __init__(
+        self,
+        paths: Sequence[Path],
+        stream: TextIO = sys.stderr,
+        json_events: bool = False,
+        interval: float = DEFAULT_INTERVAL_SECONDS,
+    ):
+        self.total_files = len(paths)
+        self.total_bytes = sum(path.stat().st_size for path in paths)
+        self.stream = stream
+        self.json_events = json_events
+        self.interval = interval
+        self._stop = threading.Event()
+        self._thread: threading.Thread | None = None
+        # Counters are process-wide; progress is measured from these baselines.
+        self._base = self._counters()
+        self._started = time.monotonic()
+
+    @staticmethod
+    def _counters() -> Dict[str, float]:
+        return {
+            "files": FILES_SCANNED.total(),
+            "bytes": BYTES_SCANNED.total(),
+            "findings": FINDINGS.total(),
+        }
+
+    def sample(self) -> Dict[str, Any]:
+        now = self._counters()
+        done = int(now["files"] - self._base["files"])
+        scanned = now["bytes"] - self._base["bytes"]
+        elapsed = max(time.monotonic() - self._started, 1e-9)
+        rate = scanned / elapsed
+        remaining_bytes = max(self.total_bytes - scanned, 0)
+        return {
+            "files_done": done,
+            "files_remaining": max(self.total_files - done, 0),
+            "mb_per_s": round(rate / 1e6, 3),
+            "findings": int(now["findings"] - self._base["findings"]),
+            "llm_queue": int(LLM_QUEUE_DEPTH.total()),
+            "elapsed_s": round(elapsed, 1),
+            # Bytes-based, so one large file doesn't skew it like a per-file average would.
+            "eta_s": round(remaining_bytes / rate, 1) if rate > 0 else None,
+        }
+
+    def _emit(self, event: str, final: bool = False) -> None:
+        state = self.sample()
+        if self.json_events:
+            self.stream.write(json.dumps({"event": event, **state}) + "\n")
+        else:
+            eta = "--" if state["eta_s"] is None else f"{state['eta_s']:.0f}s"
+            line = (
+                f"{state['files_done']}/{self.total_files} files  {state['mb_per_s']:.2f} MB/s  "
+                f"findings {state['findings']}  llm queue {state['llm_queue']}  eta {eta}"
+            )
+            interactive = self.stream.isatty()
+            self.stream.write(f"\r{line}\033[K" if interactive else line + "\n")
+            if final and interactive:
+                self.stream.write("\n")
+        self.stream.flush()
+
+    def _run(self) -> None:
+        while not self._stop.wait(self.interval):
+            self._emit("progress")
+
+    def start(self) -> None:
+        if self._thread is None:
+            self._thread = threading.Thread(target=self._run, name="codeforesight-progress", daemon=True)
+            self._thread.start()
+
+    def stop(self) -> None:
+        self._stop.set()
+        if self._thread is not None:
+            self._thread.join()
+            self._thread = None
+        self._emit("done", final=True)
+
+    def __enter__(self) -> "ProgressReporter":
+        self.start()
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.stop()
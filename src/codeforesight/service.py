@@ -0,0 +1,204 @@
+from __future__ import annotations
+
+import hashlib
+import threading
+import time
+from contextlib import contextmanager
+from dataclasses import dataclass
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Any, Dict, Iterator, List, Sequence
+
+from codeforesight.config import (
+    STAGE1_CLONE_INDEX_PATH,
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_CONFIG_PATH,
+    STAGE1_LABELS_C_PATH,
+    STAGE1_LABELS_OTHER_PATH,
+    STAGE1_MODEL_C_PATH,
+    STAGE1_MODEL_OTHER_PATH,
+    STAGE1_RULES_PATH,
+    STAGE1_SIMILAR_INDEX_DIR,
+)
+from codeforesight.data.shared_models import pinned_artifacts
+from codeforesight.data.versioned_dir import CURRENT_FILE
+from codeforesight.metrics import ARTIFACT_RELOADS, ARTIFACT_VERSION
+from codeforesight.pipeline import run_pipeline
+
+WATCHED_PATHS = [
+    STAGE1_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_LABELS_C_PATH,
+    STAGE1_MODEL_OTHER_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_LABELS_OTHER_PATH,
+    STAGE1_CONFIG_PATH,
+    STAGE1_RULES_PATH,
+    STAGE1_CLONE_INDEX_PATH,
+    # Switched in one rename when the similar-fix index is rebuilt.
+    STAGE1_SIMILAR_INDEX_DIR / CURRENT_FILE,
+    # Indexes written before versioned publishing.
+    STAGE1_SIMILAR_INDEX_DIR / "entries.json",
+]
+DEFAULT_POLL_SECONDS = 2.0
+
+
+def artifact_fingerprint(paths: Sequence[Path]) -> str:
+    """Short hash of (path, mtime, size) for every watched artifact; the version id."""
+    digest = hashlib.sha256()
+    for path in paths:
+        try:
+            stat = path.stat()
+            digest.update(f"{path}:{stat.st_mtime_ns}:{stat.st_size}\n".encode("utf-8"))
+        except FileNotFoundError:
+            digest.update(f"{path}:missing\n".encode("utf-8"))
+    return digest.hexdigest()[:12]
+
+
+def load_artifacts() -> Dict[str, Any]:
+    """Everything Stage 1 reads from disk, keyed by the names the stages `resolve`."""
+    from codeforesight.stages.stage1_clones import load_clone_index
+    from codeforesight.stages.stage1_known import load_rules
+    from codeforesight.stages.stage1_model import load_active_stage1_model, load_stage1_config
+    from codeforesight.stages.stage1_similar import load_similar_index
+
+    artifacts: Dict[str, Any] = {
+        "stage1_rules": load_rules(),
+        "clone_index": load_clone_index(),
+        "similar_index": load_similar_index(),
+    }
+    for language in ("c", "other"):
+        artifacts[f"stage1_model:{language}"] = load_active_stage1_model(language)
+        artifacts[f"stage1_config:{language}"] = load_stage1_config(language)
+    return artifacts
+
+
+@dataclass
+class ArtifactSnapshot:
+    version: str
+    loaded_at: str
+    artifacts: Dict[str, Any]
+    # Scans currently pinned to this snapshot.
+    in_flight: int = 0
+
+    def describe(self) -> Dict[str, str]:
+        return {"version": self.version, "loaded_at": self.loaded_at}
+
+
+class HotReloader:
+    """
+    Watches the Stage 1 artifacts. A background thread polls them, loads a
+    changed set off the scan path and swaps it in atomically. Scans that
+    started on the old set keep it until they finish; it is released after
+    the last one.
+    """
+
+    def __init__(self, paths: Sequence[Path] = WATCHED_PATHS, poll_seconds: float = DEFAULT_POLL_SECONDS):
+        self.paths = list(paths)
+        self.poll_seconds = poll_seconds
+        self.last_error = ""
+        self._failed_version = ""
+        self._lock = threading.Lock()
+        self._retired: List[ArtifactSnapshot] = []
+        self._stop = threading.Event()
+        self._thread: threading.Thread | None = None
+        current = self._load()
+        while current is None:
+            # Artifacts are still being written; wait for the deploy to settle.
+            time.sleep(poll_seconds)
+            current = self._load()
+        self._current = current
+        ARTIFACT_VERSION.replace(1, version=current.version)
+
+    def _load(self) -> ArtifactSnapshot | None:
+        version = artifact_fingerprint(self.paths)
+        artifacts = load_artifacts()
+        if artifact_fingerprint(self.paths) != version:
+            # A file changed while loading; the next poll loads the finished set.
+            return None
+        return ArtifactSnapshot(version, datetime.now(timezone.utc).isoformat(timespec="seconds"), artifacts)
+
+    def reload_if_changed(self) -> bool:
+        version = artifact_fingerprint(self.paths)
+        if version in {self._current.version, self._failed_version}:
+            return False
+        try:
+            snapshot = self._load()
+        except Exception as exc:
+            # Keep serving the previous version; a broken deploy is retried once it changes again.
+            self._failed_version = version
+            self.last_error = f"{version}: {type(exc).__name__}: {exc}"
+            ARTIFACT_RELOADS.inc(result="error")
+            return False
+        if snapshot is None:
+            return False
+        with self._lock:
+            previous, self._current = self._current, snapshot
+            self._release_or_retire(previous)
+        self.last_error = ""
+        ARTIFACT_RELOADS.inc(result="ok")
+        ARTIFACT_VERSION.replace(1, version=snapshot.version)
+        return True
+
+    def _release_or_retire(self, snapshot: ArtifactSnapshot) -> None:
+        if snapshot.in_flight:
+            if snapshot not in self._retired:
+                self._retired.append(snapshot)
+            return
+        if snapshot in self._retired:
+            self._retired.remove(snapshot)
+        # Dropping the references lets the models (and their mmaps) be freed.
+        snapshot.artifacts = {}
+
+    @contextmanager
+    def acquire(self) -> Iterator[ArtifactSnapshot]:
+        """Pin the current artifacts for one scan."""
+        with self._lock:
+            snapshot = self._current
+            snapshot.in_flight += 1
+        try:
+            with pinned_artifacts(snapshot.artifacts):
+                yield snapshot
+        finally:
+            with self._lock:
+                snapshot.in_flight -= 1
+                if snapshot is not self._current:
+                    self._release_or_retire(snapshot)
+
+    def _watch(self) -> None:
+        while not self._stop.wait(self.poll_seconds):
+            self.reload_if_changed()
+
+    def start(self) -> None:
+        if self._thread is None:
+            self._thread = threading.Thread(target=self._watch, name="codeforesight-reload", daemon=True)
+            self._thread.start()
+
+    def stop(self) -> None:
+        self._stop.set()
+        if self._thread is not None:
+            self._thread.join()
+            self._thread = None
+
+    def status(self) -> Dict[str, Any]:
+        with self._lock:
+            return {
+                **self._current.describe(),
+                "draining": [{**s.describe(), "in_flight": s.in_flight} for s in self._retired],
+                "last_error": self.last_error,
+            }
+
+
+class ScanService:
+    """Long-running scanner: every scan runs on one consistent, hot-reloaded artifact set."""
+
+    def __init__(self, reloader: HotReloader | None = None, **options: Any):
+        self.reloader = reloader or HotReloader()
+        self.options = options
+
+    def scan(self, input_path: Path, **overrides: Any) -> Dict[str, Any]:
+        with self.reloader.acquire() as snapshot:
+            report = run_pipeline(input_path, **{**self.options, **overrides})
+        report["artifacts"] = snapshot.describe()
+        return report
@@ -0,0 +1,93 @@
+from __future__ import annotations
+
+import re
+from dataclasses import dataclass
+from pathlib import Path
+from typing import List
+
+
+@dataclass(frozen=True)
+class SourceFunction:
+    name: str
+    start_line: int
+    end_line: int
+    text: str
+
+
+_PY_DEF_RE = re.compile(r"^([ \t]*)(?:async[ \t]+)?def[ \t]+([A-Za-z_]\w*)[ \t]*\(", re.MULTILINE)
+# Comments, string/char literals and preprocessor lines, blanked out before brace matching.
+_C_NOISE_RE = re.compile(
+    r"//[^\n]*|/\*.*?\*/|\"(?:\\.|[^\"\\\n])*\"|'(?:\\.|[^'\\\n])*'|^[ \t]*#[^\n]*",
+    re.DOTALL | re.MULTILINE,
+)
+_C_HEADER_RE = re.compile(r"([A-Za-z_][\w:~]*)\s*\([^;{}]*\)[\s\w]*(?:->[^;{}]*)?$", re.DOTALL)
+_CONTROL_WORDS = {"if", "for", "while", "switch", "catch", "return", "sizeof", "else", "do"}
+
+
+def _blank(match: re.Match) -> str:
+    # Same length and newlines so offsets and line numbers still line up.
+    return re.sub(r"[^\n]", " ", match.group(0))
+
+
+def is_python_source(path: Path | None, code: str) -> bool:
+    if path is not None and path.suffix:
+        return path.suffix.lower() == ".py"
+    return bool(_PY_DEF_RE.search(code)) and "{" not in code
+
+
+def _split_python(code: str) -> List[SourceFunction]:
+    lines = code.splitlines()
+    functions = []
+    for match in _PY_DEF_RE.finditer(code):
+        indent = len(match.group(1).expandtabs())
+        start = code.count("\n", 0, match.start())
+        end = start + 1
+        while end < len(lines):
+            line = lines[end]
+            if line.strip() and len(line) - len(line.lstrip()) <= indent and not line.lstrip().startswith(")"):
+                break
+            end += 1
+        while end > start + 1 and not lines[end - 1].strip():
+            end -= 1
+        functions.append(SourceFunction(match.group(2), start + 1, end, "\n".join(lines[start:end])))
+    return functions
+
+
+def _split_braces(code: str) -> List[SourceFunction]:
+    clean = _C_NOISE_RE.sub(_blank, code)
+    functions = []
+    depth = 0
+    boundary = 0
+    func_start = -1
+    func_depth = 0
+    func_name = ""
+    for idx, char in enumerate(clean):
+        if char == "{":
+            if func_start < 0:
+                header = _C_HEADER_RE.search(clean[boundary:idx])
+                if header and header.group(1).split("::")[-1] not in _CONTROL_WORDS:
+                    func_start = boundary + header.start()
+                    func_depth = depth
+                    func_name = header.group(1)
+            depth += 1
+            boundary = idx + 1
+        elif char == "}":
+            depth = max(depth - 1, 0)
+            boundary = idx + 1
+            if func_start >= 0 and depth == func_depth:
+                # Start at the line holding the return type, not mid-line at the name.
+                line_start = code.rfind("\n", 0, func_start) + 1
+                text = code[line_start : idx + 1]
+                start_line = code.count("\n", 0, line_start) + 1
+                functions.append(SourceFunction(func_name, start_line, start_line + text.count("\n"), text))
+                func_start = -1
+        elif char == ";":
+            boundary = idx + 1
+    return functions
+
+
+def split_functions(code: str, path: Path | None = None) -> List[SourceFunction]:
+    """Split source into functions: indentation-based for Python, brace-based otherwise."""
+    if is_python_source(path, code):
+        return _split_python(code)
+    return _split_braces(code)
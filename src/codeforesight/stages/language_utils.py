@@ -1,9 +1,11 @@
 from __future__ import annotations
 
 from pathlib import Path
+from typing import List
 
 
 _C_EXTENSIONS = {".c", ".h", ".cpp", ".cc", ".cxx", ".hpp"}
+SOURCE_EXTENSIONS = _C_EXTENSIONS | {".py", ".js", ".ts", ".java", ".go", ".rs", ".php", ".rb", ".cs"}
 
 
 def detect_language(path: Path, code: str | None = None) -> str:
@@ -13,3 +15,16 @@ def detect_language(path: Path, code: str | None = None) -> str:
         if "#include" in code or "printf(" in code or "malloc(" in code:
             return "c"
     return "other"
+
+
+def list_source_files(root: Path) -> List[Path]:
+    """Source files under `root` (or `root` itself), sorted, skipping hidden directories."""
+    if root.is_file():
+        return [root]
+    return sorted(
+        path
+        for path in root.rglob("*")
+        if path.is_file()
+        and path.suffix.lower() in SOURCE_EXTENSIONS
+        and not any(part.startswith(".") for part in path.relative_to(root).parts)
+    )
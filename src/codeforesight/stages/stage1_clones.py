@@ -0,0 +1,200 @@
+from __future__ import annotations
+
+import re
+import zlib
+from collections import defaultdict
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Tuple
+
+import numpy as np
+
+from codeforesight.config import STAGE1_CLONE_INDEX_PATH
+from codeforesight.data.curated_pairs import CuratedPair
+from codeforesight.data.shared_models import load_model, resolve
+from codeforesight.stages.function_splitter import SourceFunction, split_functions
+from codeforesight.stages.stage1_features import tokenize_code
+
+
+NUM_PERM = 128
+# 16 bands x 8 rows puts the 50% detection point near Jaccard 0.7.
+LSH_BANDS = 16
+LSH_ROWS = NUM_PERM // LSH_BANDS
+SHINGLE_SIZE = 5
+MIN_FUNCTION_TOKENS = 40
+MIN_SIMILARITY = 0.8
+
+_MERSENNE_PRIME = np.uint64((1 << 61) - 1)
+_MAX_HASH = np.uint64((1 << 32) - 1)
+_rng = np.random.RandomState(1)
+_PERM_A = _rng.randint(1, (1 << 61) - 1, size=NUM_PERM, dtype=np.uint64)
+_PERM_B = _rng.randint(0, (1 << 61) - 1, size=NUM_PERM, dtype=np.uint64)
+
+_KEYWORDS = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else",
+    "enum", "extern", "float", "for", "goto", "if", "int", "long", "register", "return",
+    "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned",
+    "void", "volatile", "while", "class", "new", "delete", "try", "catch", "throw", "public",
+    "private", "protected", "virtual", "template", "def", "lambda", "import", "from", "in",
+    "is", "not", "and", "or", "None", "True", "False", "with", "as", "yield", "async",
+    "await", "function", "var", "let", "null", "this", "self", "elif", "except", "finally",
+    "raise", "pass", "func", "go", "defer", "nil", "fn", "impl", "match", "mut",
+}
+_NUMBER_RE = re.compile(r"^(0[xX][0-9a-fA-F]+|\d+)$")
+_IDENT_RE = re.compile(r"^[A-Za-z_]\w*$")
+
+
+@dataclass(frozen=True)
+class CloneMatch:
+    cve_id: str
+    cwe_id: str
+    repo_slug: str
+    path: str
+    function: str
+    similarity: float
+    line: int
+    name: str
+
+
+def normalize_tokens(text: str) -> List[str]:
+    """
+    Type-2 clone normalization: keywords, operators and called names stay,
+    other identifiers and literals collapse so renamed copies still match.
+    """
+    tokens = tokenize_code(text)
+    out = []
+    for idx, token in enumerate(tokens):
+        if token in ('"', "'"):
+            continue
+        if _NUMBER_RE.match(token):
+            out.append("N")
+        elif _IDENT_RE.match(token) and token not in _KEYWORDS:
+            is_call = idx + 1 < len(tokens) and tokens[idx + 1] == "("
+            out.append(token if is_call else "V")
+        else:
+            out.append(token)
+    return out
+
+
+def minhash_signature(tokens: List[str]) -> np.ndarray | None:
+    if len(tokens) < max(MIN_FUNCTION_TOKENS, SHINGLE_SIZE):
+        return None
+    shingles = {
+        zlib.crc32(" ".join(tokens[i : i + SHINGLE_SIZE]).encode("utf-8"))
+        for i in range(len(tokens) - SHINGLE_SIZE + 1)
+    }
+    values = np.fromiter(shingles, dtype=np.uint64, count=len(shingles))
+    # Universal hashing (a*x + b) mod p; uint64 wraparound is fine for MinHash.
+    with np.errstate(over="ignore"):
+        hashed = ((_PERM_A[:, None] * values[None, :] + _PERM_B[:, None]) % _MERSENNE_PRIME) & _MAX_HASH
+    return hashed.min(axis=1).astype(np.uint32)
+
+
+def _band_keys(signature: np.ndarray) -> List[bytes]:
+    return [
+        band.to_bytes(1, "little") + signature[band * LSH_ROWS : (band + 1) * LSH_ROWS].tobytes()
+        for band in range(LSH_BANDS)
+    ]
+
+
+class CloneIndex:
+    """MinHash signatures of vulnerable functions, bucketed by LSH band."""
+
+    def __init__(self) -> None:
+        self.entries: List[Tuple[str, str, str, str, str]] = []
+        self.signatures = np.zeros((0, NUM_PERM), dtype=np.uint32)
+        self.buckets: Dict[bytes, List[int]] = {}
+
+    def add_all(self, items: Iterable[Tuple[Tuple[str, str, str, str, str], np.ndarray]]) -> None:
+        buckets = defaultdict(list, self.buckets)
+        signatures = [self.signatures] if len(self.signatures) else []
+        for entry, signature in items:
+            entry_id = len(self.entries)
+            self.entries.append(entry)
+            signatures.append(signature[None, :])
+            for key in _band_keys(signature):
+                buckets[key].append(entry_id)
+        self.buckets = dict(buckets)
+        if signatures:
+            self.signatures = np.vstack(signatures)
+
+    def query(self, signature: np.ndarray, min_similarity: float = MIN_SIMILARITY) -> List[Tuple[int, float]]:
+        candidates = set()
+        for key in _band_keys(signature):
+            candidates.update(self.buckets.get(key, ()))
+        if not candidates:
+            return []
+        ids = np.fromiter(candidates, dtype=np.int64, count=len(candidates))
+        similarity = (self.signatures[ids] == signature[None, :]).mean(axis=1)
+        keep = similarity >= min_similarity
+        order = np.argsort(-similarity[keep])
+        return [(int(ids[keep][i]), float(similarity[keep][i])) for i in order]
+
+
+def changed_functions(pair: CuratedPair, rel_path: str) -> List[SourceFunction]:
+    """Functions on the `before` side whose normalized body differs after the fix."""
+    path = Path(rel_path)
+    before = split_functions(pair.read_text("before", rel_path), path)
+    after_text = pair.read_text("after", rel_path) if rel_path in pair.list_files("after") else ""
+    after = {fn.name: normalize_tokens(fn.text) for fn in split_functions(after_text, path)}
+    return [fn for fn in before if after.get(fn.name) != normalize_tokens(fn.text)]
+
+
+def build_clone_index(pairs: Iterable[CuratedPair]) -> CloneIndex:
+    def _items():
+        for pair in pairs:
+            for rel_path in pair.list_files("before"):
+                for fn in changed_functions(pair, rel_path):
+                    signature = minhash_signature(normalize_tokens(fn.text))
+                    if signature is not None:
+                        yield (pair.cve_id, pair.cwe_id, pair.repo_slug, rel_path, fn.name), signature
+
+    index = CloneIndex()
+    index.add_all(_items())
+    return index
+
+
+def save_clone_index(index: CloneIndex, path: Path = STAGE1_CLONE_INDEX_PATH) -> None:
+    # Build-time only; scans load the index through load_model.
+    import joblib
+
+    path.parent.mkdir(parents=True, exist_ok=True)
+    joblib.dump(index, path)
+
+
+_INDEX_CACHE: Dict[Tuple[str, int], CloneIndex] = {}
+
+
+def load_clone_index(path: Path = STAGE1_CLONE_INDEX_PATH) -> CloneIndex | None:
+    if not path.exists():
+        return None
+    key = (str(path), path.stat().st_mtime_ns)
+    if key not in _INDEX_CACHE:
+        for stale in [k for k in _INDEX_CACHE if k[0] == key[0]]:
+            del _INDEX_CACHE[stale]
+        _INDEX_CACHE[key] = load_model(path)
+    return _INDEX_CACHE[key]
+
+
+def find_clones(
+    code: str,
+    input_path: str | None = None,
+    min_similarity: float = MIN_SIMILARITY,
+    index: CloneIndex | None = None,
+) -> List[CloneMatch]:
+    """Best match per scanned function against functions changed by known CVE fixes."""
+    index = index or resolve("clone_index", load_clone_index)
+    if index is None or not index.entries:
+        return []
+    matches = []
+    for fn in split_functions(code, Path(input_path) if input_path else None):
+        signature = minhash_signature(normalize_tokens(fn.text))
+        if signature is None:
+            continue
+        hits = index.query(signature, min_similarity)
+        if not hits:
+            continue
+        entry_id, similarity = hits[0]
+        cve_id, cwe_id, repo_slug, rel_path, function = index.entries[entry_id]
+        matches.append(CloneMatch(cve_id, cwe_id, repo_slug, rel_path, function, similarity, fn.start_line, fn.name))
+    return matches
@@ -0,0 +1,125 @@
+from __future__ import annotations
+
+import os
+from pathlib import Path
+from typing import Dict, List, Sequence
+
+import joblib
+import numpy as np
+from scipy import sparse
+from sklearn.pipeline import Pipeline
+
+
+DEFAULT_KEEP_MASS = 0.95
+
+
+class CompressedStage1Model:
+    """
+    Stage 1 classifier with pruned, int8-quantized weights in CSR form.
+    Exposes predict_proba like the sklearn pipeline it was built from.
+    """
+
+    def __init__(
+        self,
+        features: Pipeline,
+        classes: np.ndarray,
+        coef: sparse.csr_matrix,
+        scales: np.ndarray,
+        intercept: np.ndarray,
+        keep_mass: float = DEFAULT_KEEP_MASS,
+    ):
+        self.features = features
+        self.classes_ = classes
+        self.coef = coef
+        self.scales = scales
+        self.intercept = intercept
+        # Recorded so a redeploy can recompress with the operator's setting.
+        self.keep_mass = keep_mass
+
+    def decision_function(self, texts: Sequence[str]) -> np.ndarray:
+        x = self.features.transform(texts)
+        scores = np.asarray((x @ self.coef.T).todense(), dtype=np.float64)
+        return scores * self.scales + self.intercept
+
+    def predict_proba(self, texts: Sequence[str]) -> np.ndarray:
+        scores = self.decision_function(texts)
+        if scores.shape[1] == 1:
+            positive = 1.0 / (1.0 + np.exp(-scores[:, 0]))
+            return np.column_stack([1.0 - positive, positive])
+        scores -= scores.max(axis=1, keepdims=True)
+        np.exp(scores, out=scores)
+        scores /= scores.sum(axis=1, keepdims=True)
+        return scores
+
+
+def _prune_row(row: np.ndarray, keep_mass: float) -> np.ndarray:
+    """Zero the smallest weights, keeping those that carry keep_mass of the L1 norm."""
+    magnitude = np.abs(row)
+    total = magnitude.sum()
+    if total == 0.0:
+        return np.zeros_like(row)
+    order = np.argsort(magnitude)[::-1]
+    cumulative = np.cumsum(magnitude[order])
+    keep = int(np.searchsorted(cumulative, keep_mass * total)) + 1
+    pruned = np.zeros_like(row)
+    pruned[order[:keep]] = row[order[:keep]]
+    return pruned
+
+
+def compress_pipeline(pipeline: Pipeline, keep_mass: float = DEFAULT_KEEP_MASS) -> CompressedStage1Model:
+    if not 0.0 < keep_mass <= 1.0:
+        raise ValueError("keep_mass must be in (0, 1].")
+    clf = pipeline.steps[-1][1]
+    features = Pipeline(steps=pipeline.steps[:-1])
+    for _, step in features.steps:
+        # Terms dropped by max_features are kept only for introspection.
+        if hasattr(step, "stop_words_"):
+            step.stop_words_ = None
+
+    rows: List[np.ndarray] = []
+    scales: List[float] = []
+    for weights in np.asarray(clf.coef_, dtype=np.float64):
+        pruned = _prune_row(weights, keep_mass)
+        peak = float(np.abs(pruned).max())
+        scale = peak / 127.0 if peak > 0.0 else 1.0
+        rows.append(np.clip(np.rint(pruned / scale), -127, 127).astype(np.int8))
+        scales.append(scale)
+
+    coef = sparse.csr_matrix(np.vstack(rows), dtype=np.int8)
+    coef.eliminate_zeros()
+    return CompressedStage1Model(
+        features=features,
+        classes=np.asarray(clf.classes_),
+        coef=coef,
+        scales=np.asarray(scales, dtype=np.float32),
+        intercept=np.asarray(clf.intercept_, dtype=np.float32),
+        keep_mass=keep_mass,
+    )
+
+
+def compressed_keep_mass(path: Path) -> float:
+    """keep_mass an existing compressed artifact was built with (the default for older artifacts)."""
+    return float(getattr(joblib.load(path), "keep_mass", DEFAULT_KEEP_MASS))
+
+
+def compress_stage1_model(
+    model_path: Path,
+    out_path: Path,
+    keep_mass: float = DEFAULT_KEEP_MASS,
+) -> Dict[str, float]:
+    pipeline = joblib.load(model_path)
+    compressed = compress_pipeline(pipeline, keep_mass=keep_mass)
+    out_path.parent.mkdir(parents=True, exist_ok=True)
+    # Inference may pick this file up at any moment; never expose a partial pickle.
+    tmp_path = out_path.with_suffix(".tmp")
+    joblib.dump(compressed, tmp_path)
+    os.replace(tmp_path, out_path)
+
+    dense_weights = int(np.asarray(pipeline.steps[-1][1].coef_).size)
+    return {
+        "kept_weights": int(compressed.coef.nnz),
+        "total_weights": dense_weights,
+        "density": compressed.coef.nnz / dense_weights if dense_weights else 0.0,
+        "original_bytes": model_path.stat().st_size,
+        "compressed_bytes": out_path.stat().st_size,
+    }
@@ -1,11 +1,16 @@
 from __future__ import annotations
 
+import json
 import re
-from dataclasses import dataclass
+from dataclasses import asdict, dataclass, replace
 from pathlib import Path
-from typing import List
+from typing import Any, Dict, List, Tuple
 
+from codeforesight.config import STAGE1_RULES_PATH
+from codeforesight.data.shared_models import resolve
 from codeforesight.stages.language_utils import detect_language
+from codeforesight.stages.stage1_clones import find_clones
+from codeforesight.stages.stage1_similar import find_similar, load_similar_index
 from codeforesight.stages.stage1_model import predict_stage1
 
 
@@ -19,6 +24,7 @@ class Finding:
     rule_id: str
     fix: str
     file: str
+    similar_known: Dict[str, Any] | None = None
 
 
 _RULES = [
@@ -100,10 +106,52 @@ _RULES = [
 ]
 
 
+_RULES_CACHE: Dict[Tuple[str, int], List[Dict[str, Any]]] = {}
+
+
+def load_rules(path: Path = STAGE1_RULES_PATH) -> List[Dict[str, Any]]:
+    """
+    Built-in rules plus those deployed in `path` (a JSON list of rule objects
+    with a regex `pattern`); a deployed rule replaces a built-in with its id.
+    """
+    if not path.exists():
+        return _RULES
+    key = (str(path), path.stat().st_mtime_ns)
+    if key not in _RULES_CACHE:
+        for stale in [k for k in _RULES_CACHE if k[0] == key[0]]:
+            del _RULES_CACHE[stale]
+        extra = {
+            rule["rule_id"]: {**rule, "pattern": re.compile(rule["pattern"], re.IGNORECASE)}
+            for rule in json.loads(path.read_text(encoding="utf-8"))
+        }
+        merged = [extra.pop(rule["rule_id"], rule) for rule in _RULES]
+        _RULES_CACHE[key] = merged + list(extra.values())
+    return _RULES_CACHE[key]
+
+
 def _line_from_offset(text: str, offset: int) -> int:
     return text.count("\n", 0, offset) + 1
 
 
+def _context(lines: List[str], line: int, radius: int = 8) -> str:
+    if line <= 0:
+        return "\n".join(lines[:120])
+    return "\n".join(lines[max(0, line - 1 - radius) : line + radius])
+
+
+def _with_similar_known(findings: List[Finding], code: str) -> List[Finding]:
+    """Attach the closest curated CVE fix to each finding, when an index is built."""
+    index = resolve("similar_index", load_similar_index)
+    if index is None:
+        return findings
+    lines = code.splitlines()
+    enriched = []
+    for finding in findings:
+        match = find_similar(_context(lines, finding.line), index=index)
+        enriched.append(replace(finding, similar_known=asdict(match)) if match else finding)
+    return enriched
+
+
 def analyze_known(code: str, input_path: str | None = None) -> List[Finding]:
     findings: List[Finding] = []
 
@@ -112,7 +160,7 @@ def analyze_known(code: str, input_path: str | None = None) -> List[Finding]:
         language = detect_language(Path(input_path), code)
     file_path = input_path or ""
 
-    for rule in _RULES:
+    for rule in resolve("stage1_rules", load_rules):
         rule_hits = 0
         for match in rule["pattern"].finditer(code):
             line = _line_from_offset(code, match.start())
@@ -133,6 +181,23 @@ def analyze_known(code: str, input_path: str | None = None) -> List[Finding]:
             if rule_hits >= 3:
                 break
 
+    for clone in find_clones(code, input_path):
+        findings.append(
+            Finding(
+                cwe_id=clone.cwe_id or "UNKNOWN",
+                name=f"Near clone of code fixed in {clone.cve_id}",
+                severity="high",
+                line=clone.line,
+                snippet=(
+                    f"{clone.name}() ~ {clone.function}() in {clone.repo_slug}/{clone.path} "
+                    f"(similarity={clone.similarity:.2f})"
+                ),
+                rule_id="S1-CVE-CLONE",
+                fix=f"Compare with the upstream fix for {clone.cve_id} and apply the equivalent change.",
+                file=file_path,
+            )
+        )
+
     ml_prediction = predict_stage1(code, language)
     if ml_prediction:
         if ml_prediction.label != "SAFE" or not findings:
@@ -148,4 +213,4 @@ def analyze_known(code: str, input_path: str | None = None) -> List[Finding]:
                 file=file_path,
                 )
             )
-    return findings
+    return _with_similar_known(findings, code)
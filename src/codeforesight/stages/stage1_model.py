@@ -1,21 +1,43 @@
 from __future__ import annotations
 
 import json
+import random
 from dataclasses import dataclass
 from pathlib import Path
-from typing import List, Tuple
-
-import joblib
-from sklearn.feature_extraction.text import TfidfVectorizer
-from sklearn.linear_model import LogisticRegression
-from sklearn.pipeline import Pipeline
+from typing import TYPE_CHECKING, Any, Dict, List, Tuple
 
 from codeforesight.config import (
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_CONFIG_PATH,
     STAGE1_LABELS_C_PATH,
     STAGE1_LABELS_OTHER_PATH,
     STAGE1_MODEL_C_PATH,
     STAGE1_MODEL_OTHER_PATH,
 )
+from codeforesight.data.shared_models import load_model, resolve
+from codeforesight.metrics import CACHE_REQUESTS
+
+if TYPE_CHECKING:
+    from sklearn.pipeline import Pipeline
+
+
+VECTORIZER_MODES = ("tfidf", "hashing")
+
+# Overridden per language by scripts/tune_stage1_model.py via stage1_config.json.
+DEFAULT_STAGE1_PARAMS: Dict[str, Any] = {
+    "vectorizer": "tfidf",
+    "max_features": 20000,
+    "ngram_range": [1, 2],
+    "C": 1.0,
+    "threshold": 0.6,
+}
+
+# Per-label sample kept next to each model so feedback updates can replay
+# every class while warm-starting from the deployed weights.
+REPLAY_PER_LABEL = 50
+
+_MODEL_CACHE: Dict[Tuple[str, int, int], Tuple[Any, List[str]]] = {}
 
 
 @dataclass(frozen=True)
@@ -24,59 +46,148 @@ class Stage1Prediction:
     confidence: float
 
 
+def load_stage1_config(language: str, config_path: Path = STAGE1_CONFIG_PATH) -> Dict[str, Any]:
+    params = dict(DEFAULT_STAGE1_PARAMS)
+    if config_path.exists():
+        tuned = json.loads(config_path.read_text(encoding="utf-8"))
+        params.update(tuned.get("c" if language == "c" else "other", {}))
+    return params
+
+
 def train_stage1_model(
     texts: List[str],
     labels: List[str],
     model_path: Path,
     labels_path: Path,
+    vectorizer: str | None = None,
+    params: Dict[str, Any] | None = None,
 ) -> None:
     if not texts:
         raise ValueError("No training texts provided.")
     if len(texts) != len(labels):
         raise ValueError("Texts and labels length mismatch.")
-
-    pipeline: Pipeline = Pipeline(
-        steps=[
-            ("tfidf", TfidfVectorizer(max_features=20000, ngram_range=(1, 2))),
-            ("clf", LogisticRegression(max_iter=300, n_jobs=1, class_weight="balanced")),
-        ]
+    params = {**DEFAULT_STAGE1_PARAMS, **(params or {})}
+    vectorizer = vectorizer or params["vectorizer"]
+    if vectorizer not in VECTORIZER_MODES:
+        raise ValueError(f"Unknown vectorizer mode: {vectorizer}")
+    ngram_range = tuple(params["ngram_range"])
+    # Training-only imports; prediction just unpickles the fitted pipeline.
+    import joblib
+    from sklearn.feature_extraction.text import TfidfVectorizer
+    from sklearn.linear_model import LogisticRegression
+    from sklearn.pipeline import Pipeline
+
+    from codeforesight.stages.stage1_features import fit_hashed_tfidf
+
+    clf = LogisticRegression(
+        C=float(params["C"]), max_iter=300, n_jobs=1, class_weight="balanced"
     )
-    pipeline.fit(texts, labels)
+    if vectorizer == "hashing":
+        # Vocabulary-free: features are hashed, IDF is estimated in batches.
+        hasher, idf, features = fit_hashed_tfidf(texts, ngram_range=ngram_range)
+        clf.fit(features, labels)
+        pipeline = Pipeline(steps=[("hash", hasher), ("idf", idf), ("clf", clf)])
+    else:
+        pipeline = Pipeline(
+            steps=[
+                (
+                    "tfidf",
+                    TfidfVectorizer(max_features=int(params["max_features"]), ngram_range=ngram_range),
+                ),
+                ("clf", clf),
+            ]
+        )
+        pipeline.fit(texts, labels)
 
     model_path.parent.mkdir(parents=True, exist_ok=True)
     joblib.dump(pipeline, model_path)
     labels_path.write_text(json.dumps(sorted(set(labels))), encoding="utf-8")
+    _write_replay_sample(texts, labels, replay_path(model_path))
+
+
+def replay_path(model_path: Path) -> Path:
+    return model_path.with_suffix(".replay.json")
+
+
+def _write_replay_sample(texts: List[str], labels: List[str], path: Path) -> None:
+    by_label: Dict[str, List[str]] = {}
+    for text, label in zip(texts, labels):
+        by_label.setdefault(label, []).append(text)
+    rng = random.Random(0)
+    sample = []
+    for label, label_texts in sorted(by_label.items()):
+        picked = rng.sample(label_texts, min(REPLAY_PER_LABEL, len(label_texts)))
+        sample.extend({"text": text, "label": label} for text in picked)
+    path.write_text(json.dumps(sample), encoding="utf-8")
 
 
 def load_stage1_model(model_path: Path, labels_path: Path) -> Tuple[Pipeline, List[str]]:
-    model = joblib.load(model_path)
+    model = load_model(model_path)
     labels = json.loads(labels_path.read_text(encoding="utf-8"))
     return model, labels
 
 
-def _predict_with_threshold(model: Pipeline, labels: List[str], code: str) -> Stage1Prediction:
+def _load_cached(model_path: Path, labels_path: Path) -> Tuple[Any, List[str]]:
+    # Training writes the model and labels separately; a change to either reloads both.
+    key = (str(model_path), model_path.stat().st_mtime_ns, labels_path.stat().st_mtime_ns)
+    CACHE_REQUESTS.inc(cache="stage1_model", result="hit" if key in _MODEL_CACHE else "miss")
+    if key not in _MODEL_CACHE:
+        for stale in [k for k in _MODEL_CACHE if k[0] == key[0]]:
+            del _MODEL_CACHE[stale]
+        _MODEL_CACHE[key] = load_stage1_model(model_path, labels_path)
+    return _MODEL_CACHE[key]
+
+
+def _predict_with_threshold(
+    model: Any,
+    labels: List[str],
+    code: str,
+    threshold: float = 0.6,
+) -> Stage1Prediction:
     probs = model.predict_proba([code])[0]
     max_idx = int(probs.argmax())
     label = labels[max_idx]
     confidence = float(probs[max_idx])
-    if label != "SAFE" and confidence < 0.6:
+    if label != "SAFE" and confidence < threshold:
         return Stage1Prediction(label="SAFE", confidence=1.0 - confidence)
     return Stage1Prediction(label=label, confidence=confidence)
 
 
-def predict_stage1(
-    code: str,
-    language: str,
-) -> Stage1Prediction | None:
+def stage1_model_paths(language: str) -> Tuple[Path, Path] | None:
+    """(model, labels) paths inference uses for `language`, or None if not trained."""
     if language == "c":
         model_path = STAGE1_MODEL_C_PATH
+        compressed_path = STAGE1_COMPRESSED_MODEL_C_PATH
         labels_path = STAGE1_LABELS_C_PATH
     else:
         model_path = STAGE1_MODEL_OTHER_PATH
+        compressed_path = STAGE1_COMPRESSED_MODEL_OTHER_PATH
         labels_path = STAGE1_LABELS_OTHER_PATH
 
+    # Prefer the quantized artifact when it is at least as new as the full model.
+    if compressed_path.exists() and (
+        not model_path.exists() or compressed_path.stat().st_mtime >= model_path.stat().st_mtime
+    ):
+        model_path = compressed_path
+
     if not model_path.exists() or not labels_path.exists():
         return None
+    return model_path, labels_path
 
-    model, labels = load_stage1_model(model_path, labels_path)
-    return _predict_with_threshold(model, labels, code)
+
+def load_active_stage1_model(language: str) -> Tuple[Any, List[str]] | None:
+    paths = stage1_model_paths(language)
+    return _load_cached(*paths) if paths else None
+
+
+def predict_stage1(
+    code: str,
+    language: str,
+) -> Stage1Prediction | None:
+    key = "c" if language == "c" else "other"
+    loaded = resolve(f"stage1_model:{key}", lambda: load_active_stage1_model(language))
+    if loaded is None:
+        return None
+    model, labels = loaded
+    config = resolve(f"stage1_config:{key}", lambda: load_stage1_config(language))
+    return _predict_with_threshold(model, labels, code, threshold=float(config["threshold"]))
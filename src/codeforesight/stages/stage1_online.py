@@ -0,0 +1,265 @@
+from __future__ import annotations
+
+import copy
+import hashlib
+import json
+import os
+import shutil
+import time
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Any, Dict, List, Tuple
+
+import joblib
+import numpy as np
+from scipy.optimize import minimize
+from sklearn.pipeline import Pipeline
+
+from codeforesight.config import (
+    STAGE1_COMPRESSED_MODEL_C_PATH,
+    STAGE1_COMPRESSED_MODEL_OTHER_PATH,
+    STAGE1_FEEDBACK_PATH,
+    STAGE1_LABELS_C_PATH,
+    STAGE1_LABELS_OTHER_PATH,
+    STAGE1_MODEL_C_PATH,
+    STAGE1_MODEL_OTHER_PATH,
+    STAGE1_VERSIONS_DIR,
+)
+from codeforesight.data.feedback_store import load_feedback
+from codeforesight.stages.stage1_compress import compress_stage1_model, compressed_keep_mass
+from codeforesight.stages.stage1_model import replay_path
+
+
+FEEDBACK_WEIGHT = 5.0
+UPDATE_MAX_ITER = 50
+# L2 pull toward the fully trained weights. The update set is tiny, so
+# without it the refit would forget most of the full-corpus fit.
+ANCHOR_STRENGTH = 10.0
+# Every HOLDOUT_EVERY-th replay row is held out to check the update.
+HOLDOUT_EVERY = 5
+# Updates that lose more held-out accuracy than this are rejected.
+MAX_ACCURACY_DROP = 0.02
+
+
+def _model_paths(language: str) -> Tuple[Path, Path, Path]:
+    if language == "c":
+        return STAGE1_MODEL_C_PATH, STAGE1_LABELS_C_PATH, STAGE1_COMPRESSED_MODEL_C_PATH
+    return STAGE1_MODEL_OTHER_PATH, STAGE1_LABELS_OTHER_PATH, STAGE1_COMPRESSED_MODEL_OTHER_PATH
+
+
+def _versions_dir(language: str) -> Path:
+    return STAGE1_VERSIONS_DIR / language
+
+
+def _sha256(path: Path) -> str:
+    digest = hashlib.sha256()
+    with path.open("rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+def load_history(language: str) -> Dict[str, Any]:
+    path = _versions_dir(language) / "history.json"
+    if not path.exists():
+        return {"active": None, "versions": []}
+    return json.loads(path.read_text(encoding="utf-8"))
+
+
+def _save_history(language: str, history: Dict[str, Any]) -> None:
+    path = _versions_dir(language) / "history.json"
+    path.parent.mkdir(parents=True, exist_ok=True)
+    tmp_path = path.with_suffix(".tmp")
+    tmp_path.write_text(json.dumps(history, indent=2), encoding="utf-8")
+    os.replace(tmp_path, path)
+
+
+def _version_path(language: str, version: int) -> Path:
+    return _versions_dir(language) / f"v{version:04d}.joblib"
+
+
+def _find_version(history: Dict[str, Any], version: int) -> Dict[str, Any]:
+    for entry in history["versions"]:
+        if entry["version"] == version:
+            return entry
+    raise ValueError(f"Unknown Stage 1 model version: {version}")
+
+
+def _archive(language: str, source_path: Path, history: Dict[str, Any], **info: Any) -> int:
+    version = max((entry["version"] for entry in history["versions"]), default=0) + 1
+    dest = _version_path(language, version)
+    dest.parent.mkdir(parents=True, exist_ok=True)
+    shutil.copy2(source_path, dest)
+    history["versions"].append(
+        {
+            "version": version,
+            "sha256": _sha256(dest),
+            "created": datetime.now(timezone.utc).isoformat(timespec="seconds"),
+            **info,
+        }
+    )
+    history["active"] = version
+    return version
+
+
+def _activate(language: str, version: int) -> None:
+    """
+    Deploy a stored version. The new quantized artifact is built and renamed
+    into place first, then the full model is renamed in; each file is
+    replaced atomically, and the model is never newer than its q8 file.
+    """
+    model_path, _, compressed_path = _model_paths(language)
+    # Read before the swap, while it still describes the artifact the operator built.
+    keep_mass = compressed_keep_mass(compressed_path) if compressed_path.exists() else None
+    tmp_path = model_path.with_suffix(".swap")
+    # copyfile, not copy2: the archived mtime is old, and inference compares mtimes
+    # to decide whether the q8 artifact is current.
+    shutil.copyfile(_version_path(language, version), tmp_path)
+    if keep_mass is not None:
+        compress_stage1_model(tmp_path, compressed_path, keep_mass=keep_mass)
+    os.replace(tmp_path, model_path)
+
+
+def _anchored_refit(clf: Any, features: Any, targets: List[str], weights: List[float]) -> Any:
+    """
+    Copy of `clf` refit on the update set with a prior centred on its own weights:
+    sum_i w_i * logloss_i + (ANCHOR_STRENGTH / 2) * ||theta - theta_base||^2.
+    Softmax over the classes; a binary model is scored as [0, z], i.e. the sigmoid.
+    """
+    clf = copy.deepcopy(clf)
+    classes = list(clf.classes_)
+    base_coef = np.asarray(clf.coef_, dtype=np.float64)
+    base_intercept = np.asarray(clf.intercept_, dtype=np.float64)
+    base = np.concatenate([base_coef.ravel(), base_intercept])
+    rows, n_features = base_coef.shape
+    binary = rows == 1
+    onehot = np.zeros((len(targets), len(classes)))
+    onehot[np.arange(len(targets)), [classes.index(t) for t in targets]] = 1.0
+    sample_weight = np.asarray(weights, dtype=np.float64)[:, None]
+
+    def _objective(theta: np.ndarray) -> Tuple[float, np.ndarray]:
+        coef = theta[: rows * n_features].reshape(rows, n_features)
+        scores = np.asarray(features @ coef.T) + theta[rows * n_features :]
+        if binary:
+            scores = np.hstack([np.zeros((scores.shape[0], 1)), scores])
+        scores -= scores.max(axis=1, keepdims=True)
+        log_probs = scores - np.log(np.exp(scores).sum(axis=1, keepdims=True))
+        residual = (np.exp(log_probs) - onehot) * sample_weight
+        if binary:
+            residual = residual[:, 1:]
+        grad_coef = np.asarray(features.T @ residual).T
+        diff = theta - base
+        loss = -float((sample_weight * onehot * log_probs).sum()) + 0.5 * ANCHOR_STRENGTH * float(diff @ diff)
+        grad = np.concatenate([grad_coef.ravel(), residual.sum(axis=0)]) + ANCHOR_STRENGTH * diff
+        return loss, grad
+
+    result = minimize(_objective, base, jac=True, method="L-BFGS-B", options={"maxiter": UPDATE_MAX_ITER})
+    clf.coef_ = result.x[: rows * n_features].reshape(rows, n_features)
+    clf.intercept_ = result.x[rows * n_features :]
+    return clf
+
+
+def _accuracy(pipeline: Pipeline, texts: List[str], targets: List[str]) -> float:
+    if not texts:
+        return 0.0
+    return float(np.mean(np.asarray(pipeline.predict(texts)) == np.asarray(targets)))
+
+
+def _sync_history(language: str) -> Dict[str, Any]:
+    """Archive the deployed model if it was produced by a full retrain since the last update."""
+    model_path, _, _ = _model_paths(language)
+    history = load_history(language)
+    active = history["active"]
+    current_sha = _sha256(model_path)
+    if active is None or _find_version(history, active)["sha256"] != current_sha:
+        _archive(language, model_path, history, source="train", feedback_records=0)
+        _save_history(language, history)
+    return history
+
+
+def update_from_feedback(language: str, feedback_path: Path = STAGE1_FEEDBACK_PATH) -> Dict[str, Any]:
+    """
+    Refit the last fully trained classifier on all recorded verdicts plus the
+    replay sample saved at training time, anchored to its weights, then deploy
+    it as a new version. Starting from the trained base keeps repeated updates
+    idempotent. An update that loses accuracy on held-out replay rows is rejected.
+    """
+    model_path, labels_path, _ = _model_paths(language)
+    if not model_path.exists() or not labels_path.exists():
+        raise FileNotFoundError("Stage 1 model not found. Run scripts/train_stage1_model.py first.")
+
+    started = time.perf_counter()
+    history = _sync_history(language)
+    base = [entry for entry in history["versions"] if entry.get("source") == "train"][-1]
+    labels = set(json.loads(labels_path.read_text(encoding="utf-8")))
+    records = [r for r in load_feedback(feedback_path, language) if r.label in labels]
+    if not records:
+        raise ValueError(f"No applicable feedback recorded for the '{language}' model.")
+
+    replay: List[Dict[str, str]] = []
+    if replay_path(model_path).exists():
+        replay = json.loads(replay_path(model_path).read_text(encoding="utf-8"))
+    holdout = replay[::HOLDOUT_EVERY]
+    replay = [item for idx, item in enumerate(replay) if idx % HOLDOUT_EVERY]
+    texts = [r.text for r in records] + [item["text"] for item in replay]
+    targets = [r.label for r in records] + [item["label"] for item in replay]
+    weights = [FEEDBACK_WEIGHT] * len(records) + [1.0] * len(replay)
+    if set(targets) != labels:
+        raise ValueError("Replay sample does not cover every label; retrain with scripts/train_stage1_model.py.")
+
+    pipeline: Pipeline = joblib.load(_version_path(language, base["version"]))
+    features = Pipeline(steps=pipeline.steps[:-1]).transform(texts)
+    name, clf = pipeline.steps[-1]
+    holdout_texts = [item["text"] for item in holdout]
+    holdout_targets = [item["label"] for item in holdout]
+    base_accuracy = _accuracy(pipeline, holdout_texts, holdout_targets)
+    pipeline.steps[-1] = (name, _anchored_refit(clf, features, targets, weights))
+    updated_accuracy = _accuracy(pipeline, holdout_texts, holdout_targets)
+    if holdout and updated_accuracy < base_accuracy - MAX_ACCURACY_DROP:
+        raise ValueError(
+            f"Update rejected: held-out accuracy {updated_accuracy:.2%} vs {base_accuracy:.2%} "
+            f"for v{base['version']}; the deployed model is unchanged."
+        )
+
+    staged_path = model_path.with_suffix(".staged")
+    joblib.dump(pipeline, staged_path)
+    version = _archive(
+        language,
+        staged_path,
+        history,
+        source="feedback",
+        parent=base["version"],
+        feedback_records=len(records),
+        holdout_accuracy=round(updated_accuracy, 4),
+    )
+    staged_path.unlink()
+    _activate(language, version)
+    _save_history(language, history)
+    return {
+        "version": version,
+        "parent": base["version"],
+        "feedback_records": len(records),
+        "holdout_rows": len(holdout),
+        "base_accuracy": base_accuracy,
+        "holdout_accuracy": updated_accuracy,
+        "seconds": round(time.perf_counter() - started, 3),
+    }
+
+
+def rollback(language: str, version: int | None = None) -> int:
+    """Redeploy `version`, or the version deployed before the active one."""
+    model_path, _, _ = _model_paths(language)
+    if not model_path.exists():
+        raise FileNotFoundError("Stage 1 model not found. Run scripts/train_stage1_model.py first.")
+    history = _sync_history(language)
+    if version is None:
+        ordered = [entry["version"] for entry in history["versions"]]
+        position = ordered.index(history["active"])
+        if position == 0:
+            raise ValueError("No earlier Stage 1 model version to roll back to.")
+        version = ordered[position - 1]
+    _find_version(history, version)
+    _activate(language, version)
+    history["active"] = version
+    _save_history(language, history)
+    return version
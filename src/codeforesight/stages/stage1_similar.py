@@ -0,0 +1,202 @@
+from __future__ import annotations
+
+import json
+import re
+import zlib
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterable, List, Tuple
+
+import numpy as np
+
+from codeforesight.config import CVE_INDEX_PATH, STAGE1_SIMILAR_INDEX_DIR
+from codeforesight.data.curated_pairs import CuratedPair
+from codeforesight.data.versioned_dir import current_dir, publish_dir
+from codeforesight.stages.stage1_clones import changed_functions
+from codeforesight.stages.stage1_features import tokenize_code
+
+
+EMBED_DIM = 256
+DEFAULT_NPROBE = 8
+KMEANS_ITERATIONS = 12
+DESCRIPTION_WEIGHT = 0.5
+
+_SUBWORD_RE = re.compile(r"[A-Z]+(?=[A-Z][a-z])|[A-Z]?[a-z]+|[A-Z]+|\d+")
+_WORD_RE = re.compile(r"[A-Za-z][A-Za-z0-9_]+")
+
+
+@dataclass(frozen=True)
+class SimilarKnown:
+    cve_id: str
+    cwe_id: str
+    repo_slug: str
+    path: str
+    function: str
+    description: str
+    score: float
+
+
+def _subwords(token: str) -> List[str]:
+    return [part.lower() for part in _SUBWORD_RE.findall(token)]
+
+
+def _hash_into(vector: np.ndarray, features: Iterable[str], weight: float = 1.0) -> None:
+    for feature in features:
+        h = zlib.crc32(feature.encode("utf-8"))
+        vector[h % EMBED_DIM] += weight if h & 0x80000000 else -weight
+
+
+def _normalize(vector: np.ndarray) -> np.ndarray:
+    norm = float(np.linalg.norm(vector))
+    return vector / norm if norm else vector
+
+
+def embed_code(text: str) -> np.ndarray:
+    """Signed feature hashing of code tokens, identifier subwords and token bigrams."""
+    vector = np.zeros(EMBED_DIM, dtype=np.float32)
+    tokens = tokenize_code(text)
+    _hash_into(vector, tokens)
+    _hash_into(vector, (f"{a} {b}" for a, b in zip(tokens, tokens[1:])), 0.5)
+    _hash_into(vector, (word for token in tokens if token[:1].isalpha() for word in _subwords(token)))
+    return _normalize(vector)
+
+
+def embed_description(text: str) -> np.ndarray:
+    # Description words land in the same buckets as identifier subwords ("buffer", "length", ...).
+    vector = np.zeros(EMBED_DIM, dtype=np.float32)
+    _hash_into(vector, (word for token in _WORD_RE.findall(text) for word in _subwords(token)))
+    return _normalize(vector)
+
+
+def _spherical_kmeans(vectors: np.ndarray, k: int, seed: int = 0) -> Tuple[np.ndarray, np.ndarray]:
+    rng = np.random.RandomState(seed)
+    centroids = vectors[rng.choice(len(vectors), size=k, replace=False)].copy()
+    assign = np.zeros(len(vectors), dtype=np.int64)
+    for _ in range(KMEANS_ITERATIONS):
+        assign = (vectors @ centroids.T).argmax(axis=1)
+        for c in range(k):
+            members = vectors[assign == c]
+            if len(members):
+                centroids[c] = _normalize(members.sum(axis=0))
+    return centroids, assign
+
+
+class SimilarIndex:
+    """
+    IVF index over unit vectors: rows are grouped by nearest centroid so a query
+    scores only the `nprobe` closest lists. Arrays are memory-mapped on load.
+    """
+
+    def __init__(self, centroids: np.ndarray, offsets: np.ndarray, vectors: np.ndarray, entries: List[dict]):
+        self.centroids = centroids
+        self.offsets = offsets
+        self.vectors = vectors
+        self.entries = entries
+
+    @classmethod
+    def build(cls, vectors: np.ndarray, entries: List[dict]) -> "SimilarIndex":
+        n_lists = max(1, int(np.sqrt(len(vectors))))
+        centroids, assign = _spherical_kmeans(vectors, n_lists)
+        order = np.argsort(assign, kind="stable")
+        offsets = np.zeros(n_lists + 1, dtype=np.int64)
+        offsets[1:] = np.cumsum(np.bincount(assign, minlength=n_lists))
+        return cls(
+            centroids.astype(np.float32),
+            offsets,
+            np.ascontiguousarray(vectors[order], dtype=np.float32),
+            [entries[i] for i in order],
+        )
+
+    def save(self, out_dir: Path) -> None:
+        # Published as one version, so readers never mix centroids and lists from two builds.
+        with publish_dir(out_dir) as version_dir:
+            for name, array in (("centroids", self.centroids), ("offsets", self.offsets), ("vectors", self.vectors)):
+                np.save(version_dir / f"{name}.npy", array)
+            (version_dir / "entries.json").write_text(json.dumps(self.entries), encoding="utf-8")
+
+    @classmethod
+    def load(cls, index_dir: Path) -> "SimilarIndex":
+        index_dir = current_dir(index_dir)
+        return cls(
+            np.load(index_dir / "centroids.npy", mmap_mode="r"),
+            np.load(index_dir / "offsets.npy"),
+            np.load(index_dir / "vectors.npy", mmap_mode="r"),
+            json.loads((index_dir / "entries.json").read_text(encoding="utf-8")),
+        )
+
+    def search(self, query: np.ndarray, k: int = 1, nprobe: int = DEFAULT_NPROBE) -> List[Tuple[int, float]]:
+        if not len(self.entries) or not query.any():
+            return []
+        lists = np.argsort(-(self.centroids @ query))[:nprobe]
+        ids = np.concatenate([np.arange(self.offsets[c], self.offsets[c + 1]) for c in lists])
+        if not len(ids):
+            return []
+        scores = self.vectors[ids] @ query
+        top = np.argsort(-scores)[:k]
+        return [(int(ids[i]), float(scores[i])) for i in top]
+
+
+def _load_descriptions(cve_index_path: Path) -> Dict[str, str]:
+    if not cve_index_path.exists():
+        return {}
+    records = json.loads(cve_index_path.read_text(encoding="utf-8"))
+    return {r["cve_id"]: r.get("description", "") for r in records if r.get("cve_id")}
+
+
+def build_similar_index(
+    pairs: Iterable[CuratedPair],
+    cve_index_path: Path = CVE_INDEX_PATH,
+) -> SimilarIndex | None:
+    descriptions = _load_descriptions(cve_index_path)
+    vectors: List[np.ndarray] = []
+    entries: List[dict] = []
+    for pair in pairs:
+        description = descriptions.get(pair.cve_id, "")
+        desc_vector = embed_description(description) if description else None
+        for rel_path in pair.list_files("before"):
+            for fn in changed_functions(pair, rel_path):
+                vector = embed_code(fn.text)
+                if desc_vector is not None:
+                    vector = _normalize(vector + DESCRIPTION_WEIGHT * desc_vector)
+                vectors.append(vector)
+                entries.append(
+                    {
+                        "cve_id": pair.cve_id,
+                        "cwe_id": pair.cwe_id,
+                        "repo_slug": pair.repo_slug,
+                        "path": rel_path,
+                        "function": fn.name,
+                        "description": description[:300],
+                    }
+                )
+    if not vectors:
+        return None
+    return SimilarIndex.build(np.vstack(vectors), entries)
+
+
+_INDEX_CACHE: Dict[Tuple[str, str, int], SimilarIndex] = {}
+
+
+def load_similar_index(index_dir: Path = STAGE1_SIMILAR_INDEX_DIR) -> SimilarIndex | None:
+    data_dir = current_dir(index_dir)
+    marker = data_dir / "entries.json"
+    if not marker.exists():
+        return None
+    key = (str(index_dir), data_dir.name, marker.stat().st_mtime_ns)
+    if key not in _INDEX_CACHE:
+        for stale in [k for k in _INDEX_CACHE if k[0] == key[0]]:
+            del _INDEX_CACHE[stale]
+        _INDEX_CACHE[key] = SimilarIndex.load(data_dir)
+    return _INDEX_CACHE[key]
+
+
+def find_similar(text: str, index: SimilarIndex | None = None, min_score: float = 0.3) -> SimilarKnown | None:
+    """Most similar curated CVE fix for a code fragment, or None below `min_score`."""
+    index = index or load_similar_index()
+    if index is None:
+        return None
+    hits = index.search(embed_code(text), k=1)
+    if not hits or hits[0][1] < min_score:
+        return None
+    entry_id, score = hits[0]
+    return SimilarKnown(score=round(score, 3), **index.entries[entry_id])
@@ -1,11 +1,21 @@
 from __future__ import annotations
 
+import contextvars
 import json
 import re
+from concurrent.futures import ThreadPoolExecutor
 from dataclasses import dataclass
-from typing import Any, Dict, List
+from pathlib import Path
+from typing import Any, Dict, Iterable, List, Tuple
 
 from codeforesight.llm.groq_client import analyze_unknown_findings
+from codeforesight.llm.prompt_compression import CompressedCode, compress_code, estimate_tokens
+from codeforesight.stages.function_splitter import split_functions
+
+# Rendered-prompt budget per Stage 2 call; larger files are map-reduced over segments.
+SEGMENT_TOKENS = 3000
+# Upper bound on threads; the shared rate limiter decides how many calls really run at once.
+MAX_SEGMENT_WORKERS = 8
 
 
 @dataclass(frozen=True)
@@ -40,18 +50,84 @@ def _extract_json(raw: str) -> Dict[str, Any] | None:
         return None
 
 
-def analyze_unknown(code: str) -> Dict[str, Any]:
+def _segment_bounds(
+    code: str, compressed: CompressedCode, token_budget: int, path: Path | None = None
+) -> List[Tuple[int, int]]:
+    """
+    Original-line ranges covering the whole file, cut at top-level function
+    starts and packed greedily so each renders to about `token_budget` tokens.
+    A single function larger than the budget is cut into line chunks.
     """
-    LLM-based unknown vulnerability detection.
+    total = len(code.splitlines())
+    cost = [0] * (total + 1)
+    for number, text in zip(compressed.line_map, compressed.lines):
+        # Line-number prefix and newline on top of the line itself.
+        cost[number] = estimate_tokens(text) + 3
+    if sum(cost) <= token_budget:
+        return [(1, total)] if total else []
+
+    starts = [1]
+    covered = 0
+    for fn in sorted(split_functions(code, path), key=lambda f: f.start_line):
+        if fn.start_line > covered:
+            if fn.start_line > 1:
+                starts.append(fn.start_line)
+            covered = fn.end_line
+    units = [(start, end - 1) for start, end in zip(starts, starts[1:] + [total + 1])]
+
+    segments: List[Tuple[int, int]] = []
+    current: List[int] | None = None
+    used = 0
+    for start, end in units:
+        unit_cost = sum(cost[start : end + 1])
+        if current is not None and used + unit_cost <= token_budget:
+            current[1], used = end, used + unit_cost
+            continue
+        if current is not None:
+            segments.append((current[0], current[1]))
+        current, used = [start, start - 1], 0
+        for number in range(start, end + 1):
+            if used + cost[number] > token_budget and current[1] >= current[0]:
+                segments.append((current[0], current[1]))
+                current, used = [number, number - 1], 0
+            current[1], used = number, used + cost[number]
+    if current is not None:
+        segments.append((current[0], current[1]))
+    return segments
+
+
+def _dedupe(findings: Iterable[Dict[str, Any]]) -> List[Dict[str, Any]]:
+    """Drop repeats of the same issue on the same line (segments can overlap in what they report)."""
+    seen = set()
+    unique: List[Dict[str, Any]] = []
+    for item in findings:
+        key = (re.sub(r"\W+", " ", str(item.get("issue", ""))).strip().lower(), item.get("line", 0))
+        if key in seen:
+            continue
+        seen.add(key)
+        unique.append(item)
+    return unique
+
+
+def analyze_unknown(
+    code: str,
+    compressed: CompressedCode | None = None,
+    path: Path | None = None,
+    segment_tokens: int = SEGMENT_TOKENS,
+) -> Dict[str, Any]:
+    """
+    LLM-based unknown vulnerability detection. Files over `segment_tokens` are
+    split into function-aligned segments that are analyzed concurrently, and
+    their findings merged with absolute line numbers.
     """
     lines = code.splitlines()
-    snippet = "\n".join(lines[-200:]) if len(lines) > 200 else "\n".join(lines)
+    compressed = compressed or compress_code(code, path)
+    segments = _segment_bounds(code, compressed, segment_tokens, path) or [(1, 0)]
     focus: List[str] = []
     if "apply_coupon_after_checkout" in code and "total = total - 100" in code:
         focus.append("apply_coupon_after_checkout")
     if "view_admin_report" in code and "if (!is_admin)" not in code and "if (is_admin)" not in code:
         focus.append("view_admin_report")
-    response = analyze_unknown_findings(snippet, focus=focus, force=bool(focus))
 
     def _has_admin_check(source: str) -> bool:
         if "view_admin_report" not in source:
@@ -111,37 +187,75 @@ def analyze_unknown(code: str) -> Dict[str, Any]:
             )
         return findings
 
-    if response.get("status") == "ok":
+    def _anchor(item: Dict[str, Any], first: int, last: int) -> Dict[str, Any]:
+        # Prompt lines carry original numbers; only re-locate lines that fall outside the segment.
+        try:
+            line = int(item.get("line", 0))
+        except (TypeError, ValueError):
+            line = 0
+        if first <= line <= last:
+            return item
+        needle = str(item.get("snippet", "")).strip()
+        if needle:
+            for idx in range(first, last + 1):
+                if needle in lines[idx - 1]:
+                    return {**item, "line": idx}
+        return item
+
+    def _analyze_segment(first: int, last: int) -> Dict[str, Any]:
+        snippet = compressed.render(first, last)
+        segment_text = "\n".join(lines[first - 1 : last])
+        segment_focus = [name for name in focus if name in segment_text]
+        response = analyze_unknown_findings(snippet, focus=segment_focus, force=bool(segment_focus))
+        if response.get("status") != "ok":
+            return response
         raw = response.get("raw", "")
-        data = _extract_json(raw)
+        model = response.get("model", "")
+        # Schema-validated when structured output worked; the lenient parser covers the rest.
+        data = response.get("data") or _extract_json(raw)
         if data is None:
-            # Retry with stricter prompt to force short JSON
-            retry = analyze_unknown_findings(snippet, strict=True, focus=focus, force=bool(focus))
-            if retry.get("status") == "ok":
-                raw_retry = retry.get("raw", "")
-                data_retry = _extract_json(raw_retry)
-                if data_retry is not None:
-                    filtered_retry = _filter_findings(data_retry.get("findings", []))
-                    if not filtered_retry and focus:
-                        filtered_retry = _fallback_logic_findings()
-                    return {
-                        "status": "ok",
-                        "model": retry.get("model", ""),
-                        "findings": filtered_retry,
-                    }
-            return {
-                "status": "error",
-                "reason": "LLM returned non-JSON response",
-                "raw": raw,
-                "findings": [],
-            }
-        filtered = _filter_findings(data.get("findings", []))
-        if not filtered and focus:
-            filtered = _fallback_logic_findings()
-        return {
-            "status": "ok",
-            "model": response.get("model", ""),
-            "findings": filtered,
-        }
-
-    return response
+            # One strict, schema-in-prompt retry: only reached if structured output failed.
+            retry = analyze_unknown_findings(
+                snippet, strict=True, focus=segment_focus, force=bool(segment_focus), structured=False
+            )
+            data = _extract_json(retry.get("raw", "")) if retry.get("status") == "ok" else None
+            if data is None:
+                return {
+                    "status": "error",
+                    "reason": "LLM returned non-JSON response",
+                    "raw": raw,
+                    "findings": [],
+                }
+            model = retry.get("model", "")
+        findings = [
+            _anchor(item, first, last) for item in data.get("findings", []) if isinstance(item, dict)
+        ]
+        return {"status": "ok", "model": model, "findings": findings}
+
+    if len(segments) == 1:
+        results = [_analyze_segment(*segments[0])]
+    else:
+        with ThreadPoolExecutor(max_workers=min(len(segments), MAX_SEGMENT_WORKERS)) as pool:
+            # Each task runs in a copy of this context so usage tracking and the deadline follow it.
+            futures = [
+                pool.submit(contextvars.copy_context().run, _analyze_segment, first, last)
+                for first, last in segments
+            ]
+            results = [future.result() for future in futures]
+
+    succeeded = [result for result in results if result.get("status") == "ok"]
+    if not succeeded:
+        return results[0]
+    filtered = _filter_findings(_dedupe(f for result in succeeded for f in result["findings"]))
+    if not filtered and focus:
+        filtered = _fallback_logic_findings()
+    merged: Dict[str, Any] = {
+        "status": "ok",
+        "model": succeeded[0].get("model", ""),
+        "findings": filtered,
+    }
+    if len(segments) > 1:
+        merged["segments"] = len(segments)
+        if len(succeeded) < len(results):
+            merged["segments_failed"] = len(results) - len(succeeded)
+    return merged
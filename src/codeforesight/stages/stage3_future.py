@@ -4,6 +4,7 @@ from dataclasses import dataclass, asdict
 from typing import List, Dict, Any
 
 from codeforesight.config import CWE_CSV
+from codeforesight.data.cve_text_index import load_cve_text_index
 from codeforesight.data.cwe_loader import load_cwe_catalog
 from codeforesight.stages.stage3_temporal import predict_temporal_risk, summarize_recent_cwe_trends
 
@@ -40,10 +41,16 @@ def analyze_future(code: str, stage1_findings: List[dict], stage2_findings: List
     catalog = {}
     if CWE_CSV.exists():
         catalog = load_cwe_catalog(CWE_CSV)
+    text_index = load_cve_text_index()
     enriched: List[Dict[str, Any]] = []
     for item in likely_vulnerabilities:
         cwe_id = item.get("cwe_id", "")
         record = catalog.get(cwe_id)
+        example_cves: List[str] = []
+        if text_index is not None and record:
+            # CWE id plus its catalog name, e.g. "cwe-89 SQL Injection".
+            hits = text_index.search(f"{cwe_id} {record.name}", k=3)
+            example_cves = [hit.cve_id for hit in hits]
         observed = cwe_id in input_cwes
         relevance = int(item.get("count", 0)) * (2 if observed else 1)
         enriched.append(
@@ -54,6 +61,7 @@ def analyze_future(code: str, stage1_findings: List[dict], stage2_findings: List
                 "count": item.get("count", 0),
                 "observed_in_input": observed,
                 "relevance_score": relevance,
+                "example_cves": example_cves,
                 "reference": f"https://cwe.mitre.org/data/definitions/{cwe_id.split('-')[-1]}.html"
                 if cwe_id.startswith("CWE-")
                 else "",
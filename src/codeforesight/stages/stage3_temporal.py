@@ -5,9 +5,6 @@ from dataclasses import dataclass
 from pathlib import Path
 from typing import Dict, List, Tuple
 
-import joblib
-from sklearn.linear_model import LogisticRegression, Ridge
-
 from codeforesight.config import (
     NVD_DIR,
     STAGE3_TEMPORAL_META_PATH,
@@ -16,6 +13,7 @@ from codeforesight.config import (
     STAGE3_TIMELINE_MODEL_PATH,
 )
 from codeforesight.data.nvd_loader import iter_nvd_records
+from codeforesight.data.shared_models import load_model
 
 
 @dataclass(frozen=True)
@@ -139,6 +137,10 @@ def train_temporal_model(
     if len(values) <= window:
         raise RuntimeError("Not enough NVD history to train temporal model.")
 
+    # Training-only imports; prediction just unpickles the fitted models.
+    import joblib
+    from sklearn.linear_model import LogisticRegression, Ridge
+
     x, y = _build_samples(values, window)
     model = Ridge(alpha=1.0)
     model.fit(x, y)
@@ -207,7 +209,7 @@ def predict_temporal_risk(
             timeline_confidence=0.0,
         )
 
-    model = joblib.load(model_path)
+    model = load_model(model_path)
     recent_window = values[-window:]
     forecast = float(model.predict([recent_window])[0])
     forecast = max(forecast, 0.0)
@@ -221,7 +223,7 @@ def predict_temporal_risk(
     if STAGE3_TIMELINE_MODEL_PATH.exists() and STAGE3_TIMELINE_META_PATH.exists():
         timeline_meta = json.loads(STAGE3_TIMELINE_META_PATH.read_text(encoding="utf-8"))
         if timeline_meta.get("status") == "ok":
-            timeline_model = joblib.load(STAGE3_TIMELINE_MODEL_PATH)
+            timeline_model = load_model(STAGE3_TIMELINE_MODEL_PATH)
             proba = timeline_model.predict_proba([recent_window])[0]
             # index 1 = high (3-6 months), index 0 = low (6-12 months)
             timeline_bucket = "3-6 months" if proba[1] >= 0.5 else "6-12 months"